@@ -1 +0,0 @@
-ip a | awk '/UP / {print $9}'
@@ -1 +0,0 @@
-sysctl net.ipv4.ip_forward | awk '{print $3}'
@@ -1 +0,0 @@
-ifconfig ${1} | awk '/inet / { print $2}' | cut -d':' -f2
@@ -1 +0,0 @@
-ifconfig ${1} | awk '/HWaddr / { print $5 }'
@@ -1 +0,0 @@
-ifconfig ${1} | awk '/MTU:/ {print $5}' | sed 's/\MTU://g'
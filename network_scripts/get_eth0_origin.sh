@@ -1 +0,0 @@
-uci show network.lan.proto | cut -d'=' -f2
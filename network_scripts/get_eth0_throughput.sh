@@ -1 +0,0 @@
-ifconfig ${1} | awk '/RX bytes/ { print $2 }' | cut -d':' -f2
@@ -1 +0,0 @@
-cut -f1  /sys/class/net/${1}/statistics/tx_errors
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "address.h"
+
+#define ADDRESS_LIST_INIT_SIZE 4
+
+void
+address_list_init(struct address_list *list)
+{
+    list->items = NULL;
+    list->count = 0;
+    list->size = 0;
+}
+
+void
+address_list_free(struct address_list *list)
+{
+    free(list->items);
+    address_list_init(list);
+}
+
+static int
+address_list_reserve(struct address_list *list, size_t count)
+{
+    struct ip_address *items;
+    size_t size = list->size ? list->size : ADDRESS_LIST_INIT_SIZE;
+
+    if (count <= list->size) {
+        return 0;
+    }
+
+    while (size < count) {
+        size *= 2;
+    }
+
+    items = realloc(list->items, size * sizeof(*items));
+    if (!items) {
+        return -1;
+    }
+
+    list->items = items;
+    list->size = size;
+
+    return 0;
+}
+
+int
+address_list_copy(struct address_list *dst, const struct address_list *src)
+{
+    if (address_list_reserve(dst, src->count)) {
+        return -1;
+    }
+
+    if (src->count) {
+        memcpy(dst->items, src->items, src->count * sizeof(*src->items));
+    }
+    dst->count = src->count;
+
+    return 0;
+}
+
+void
+address_list_move(struct address_list *dst, struct address_list *src)
+{
+    address_list_free(dst);
+    *dst = *src;
+    address_list_init(src);
+}
+
+/* Interfaces carry at most few dozens of addresses, linear search is
+ * cheaper than keeping an index. */
+struct ip_address *
+address_list_find(const struct address_list *list, const char *ip)
+{
+    struct ip_address *address;
+
+    address_list_for_each(address, list) {
+        if (!strcmp(address->ip, ip)) {
+            return address;
+        }
+    }
+
+    return NULL;
+}
+
+struct ip_address *
+address_list_add(struct address_list *list, const char *ip, uint8_t prefix_length)
+{
+    struct ip_address *address = address_list_find(list, ip);
+
+    if (!address) {
+        if (address_list_reserve(list, list->count + 1)) {
+            return NULL;
+        }
+        address = &list->items[list->count++];
+        memset(address, 0, sizeof(*address));
+        snprintf(address->ip, sizeof(address->ip), "%s", ip);
+    }
+    address->subnet.prefix_length = prefix_length;
+
+    return address;
+}
+
+void
+address_list_remove(struct address_list *list, const char *ip)
+{
+    struct ip_address *address = address_list_find(list, ip);
+    size_t tail;
+
+    if (!address) {
+        return;
+    }
+
+    /* Order is kept, primary address stays first. */
+    tail = list->items + list->count - (address + 1);
+    memmove(address, address + 1, tail * sizeof(*address));
+    list->count--;
+}
+
+int
+address_list_diff(const struct address_list *old, const struct address_list *new,
+                  struct address_list *added, struct address_list *removed)
+{
+    const struct ip_address *address, *other;
+
+    added->count = 0;
+    removed->count = 0;
+
+    address_list_for_each(address, old) {
+        other = address_list_find(new, address->ip);
+        if (other && other->subnet.prefix_length == address->subnet.prefix_length) {
+            continue;
+        }
+        if (!address_list_add(removed, address->ip, address->subnet.prefix_length)) {
+            return -1;
+        }
+    }
+
+    address_list_for_each(address, new) {
+        other = address_list_find(old, address->ip);
+        if (other && other->subnet.prefix_length == address->subnet.prefix_length) {
+            continue;
+        }
+        if (!address_list_add(added, address->ip, address->subnet.prefix_length)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+char *
+address_to_cidr(const struct ip_address *address, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s/%u", address->ip, address->subnet.prefix_length);
+
+    return buf;
+}
@@ -0,0 +1,80 @@
+#ifndef __ADDRESS_H__
+#define __ADDRESS_H__
+
+#include <stddef.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+
+#define ADDRESS_IP_LEN INET6_ADDRSTRLEN
+#define ADDRESS_CIDR_LEN (ADDRESS_IP_LEN + 4)     /* "ip/nnn" and terminator */
+
+/* IPv4 or IPv6 address in text form. */
+struct ip_address
+{
+    char ip[ADDRESS_IP_LEN];
+    union subnet_s
+    {
+        uint8_t prefix_length;
+        char *netmask;
+    } subnet;
+};
+
+/**
+ * Addresses of one family and interface keyed by ip.
+ *
+ * Addresses keep order in which they were added, first one is the
+ * primary address.
+ */
+struct address_list {
+    struct ip_address *items;
+    size_t count;
+    size_t size;                    /* allocated items */
+};
+
+#define address_list_for_each(ADDR, LIST) \
+    for (ADDR = (LIST)->items; ADDR < (LIST)->items + (LIST)->count; ADDR++)
+
+void address_list_init(struct address_list *list);
+void address_list_free(struct address_list *list);
+
+/**
+ * @brief Replace content of dst with copy of src.
+ *
+ * @return 0 on success, -1 on allocation failure (dst is unchanged).
+ */
+int address_list_copy(struct address_list *dst, const struct address_list *src);
+
+/**
+ * @brief Move content of src to dst, src is left empty.
+ */
+void address_list_move(struct address_list *dst, struct address_list *src);
+
+struct ip_address *address_list_find(const struct address_list *list, const char *ip);
+
+/**
+ * @brief Add address to the end of list, prefix length of address
+ * already in list is updated instead.
+ *
+ * @return Address in list or NULL on allocation failure.
+ */
+struct ip_address *address_list_add(struct address_list *list, const char *ip, uint8_t prefix_length);
+
+void address_list_remove(struct address_list *list, const char *ip);
+
+/**
+ * @brief Compute addresses to remove and to add to get from old to new.
+ *
+ * Address whose prefix length changed is in both lists, with old prefix
+ * length in removed and new one in added.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int address_list_diff(const struct address_list *old, const struct address_list *new,
+                      struct address_list *added, struct address_list *removed);
+
+/**
+ * @brief Format address in CIDR notation.
+ */
+char *address_to_cidr(const struct ip_address *address, char *buf, size_t size);
+
+#endif /* __ADDRESS_H__ */
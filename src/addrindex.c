@@ -0,0 +1,277 @@
+#include <stdlib.h>
+#include <sys/socket.h>
+
+#include "addrindex.h"
+
+static struct list_head *
+index_bucket(struct list_head *buckets, size_t size, int ifindex)
+{
+    return &buckets[(size_t) ifindex & (size - 1)];
+}
+
+static struct list_head *
+buckets_alloc(size_t count)
+{
+    struct list_head *buckets = malloc(count * sizeof(*buckets));
+
+    if (!buckets) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        INIT_LIST_HEAD(&buckets[i]);
+    }
+
+    return buckets;
+}
+
+/* Double number of buckets, on allocation failure index keeps working
+ * with longer chains. */
+static void
+addr_index_grow(struct addr_index *idx)
+{
+    struct list_head *buckets;
+    struct if_addrs *ifa, *tmp;
+    size_t size = idx->size * 2;
+
+    buckets = buckets_alloc(size);
+    if (!buckets) {
+        return;
+    }
+
+    for (size_t i = 0; i < idx->size; i++) {
+        list_for_each_entry_safe(ifa, tmp, &idx->buckets[i], node) {
+            list_del(&ifa->node);
+            list_add(&ifa->node, index_bucket(buckets, size, ifa->ifindex));
+        }
+    }
+
+    free(idx->buckets);
+    idx->buckets = buckets;
+    idx->size = size;
+}
+
+static struct if_addrs *
+if_addrs_new(struct addr_index *idx, int ifindex)
+{
+    struct if_addrs *ifa;
+
+    if (idx->interfaces >= idx->size * ADDR_INDEX_MAX_LOAD) {
+        addr_index_grow(idx);
+    }
+
+    ifa = calloc(1, sizeof(*ifa));
+    if (!ifa) {
+        return NULL;
+    }
+
+    ifa->ifindex = ifindex;
+    for (int i = 0; i < ADDR_FAMILY_COUNT; i++) {
+        INIT_LIST_HEAD(&ifa->addrs[i]);
+    }
+    list_add(&ifa->node, index_bucket(idx->buckets, idx->size, ifindex));
+    idx->interfaces++;
+
+    return ifa;
+}
+
+static void
+if_addrs_free(struct addr_index *idx, struct if_addrs *ifa)
+{
+    struct addr_entry *entry, *tmp;
+
+    for (int i = 0; i < ADDR_FAMILY_COUNT; i++) {
+        list_for_each_entry_safe(entry, tmp, &ifa->addrs[i], head) {
+            list_del(&entry->head);
+            rtnl_addr_put(entry->addr);
+            free(entry);
+            idx->addresses--;
+        }
+    }
+
+    list_del(&ifa->node);
+    idx->interfaces--;
+    free(ifa);
+}
+
+/* Remove entry identical to addr, interface entry is freed with its last address. */
+static void
+if_addrs_remove(struct addr_index *idx, struct if_addrs *ifa, addr_family family,
+                struct rtnl_addr *addr)
+{
+    struct addr_entry *entry, *tmp;
+
+    list_for_each_entry_safe(entry, tmp, &ifa->addrs[family], head) {
+        if (nl_object_identical(OBJ_CAST(entry->addr), OBJ_CAST(addr))) {
+            list_del(&entry->head);
+            rtnl_addr_put(entry->addr);
+            free(entry);
+            ifa->count[family]--;
+            idx->addresses--;
+        }
+    }
+
+    for (int i = 0; i < ADDR_FAMILY_COUNT; i++) {
+        if (ifa->count[i]) {
+            return;
+        }
+    }
+
+    if_addrs_free(idx, ifa);
+}
+
+addr_family
+addr_index_family(int family)
+{
+    switch (family) {
+    case AF_INET: return ADDR_FAMILY_INET;
+    case AF_INET6: return ADDR_FAMILY_INET6;
+    default: return ADDR_FAMILY_COUNT;
+    }
+}
+
+struct addr_index *
+addr_index_new(void)
+{
+    struct addr_index *idx;
+
+    idx = calloc(1, sizeof(*idx));
+    if (!idx) {
+        return NULL;
+    }
+
+    idx->size = ADDR_INDEX_INIT_BUCKETS;
+    idx->buckets = buckets_alloc(idx->size);
+    if (!idx->buckets) {
+        free(idx);
+        return NULL;
+    }
+
+    return idx;
+}
+
+void
+addr_index_free(struct addr_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+
+    addr_index_clear(idx);
+    free(idx->buckets);
+    free(idx);
+}
+
+void
+addr_index_clear(struct addr_index *idx)
+{
+    struct if_addrs *ifa, *tmp;
+
+    for (size_t i = 0; i < idx->size; i++) {
+        list_for_each_entry_safe(ifa, tmp, &idx->buckets[i], node) {
+            if_addrs_free(idx, ifa);
+        }
+    }
+}
+
+struct if_addrs *
+addr_index_find(struct addr_index *idx, int ifindex)
+{
+    struct if_addrs *ifa;
+
+    list_for_each_entry(ifa, index_bucket(idx->buckets, idx->size, ifindex), node) {
+        if (ifa->ifindex == ifindex) {
+            return ifa;
+        }
+    }
+
+    return NULL;
+}
+
+int
+addr_index_add(struct addr_index *idx, struct rtnl_addr *addr)
+{
+    addr_family family = addr_index_family(rtnl_addr_get_family(addr));
+    int ifindex = rtnl_addr_get_ifindex(addr);
+    struct addr_entry *entry;
+    struct if_addrs *ifa;
+
+    if (ADDR_FAMILY_COUNT == family) {
+        return 0;
+    }
+
+    ifa = addr_index_find(idx, ifindex);
+    if (ifa) {
+        /* Cache may hand over new object for address already indexed. */
+        addr_index_for_each(entry, ifa, family) {
+            if (nl_object_identical(OBJ_CAST(entry->addr), OBJ_CAST(addr))) {
+                nl_object_get(OBJ_CAST(addr));
+                rtnl_addr_put(entry->addr);
+                entry->addr = addr;
+                return 0;
+            }
+        }
+    } else {
+        ifa = if_addrs_new(idx, ifindex);
+        if (!ifa) {
+            return -1;
+        }
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+        /* Interface entry without addresses is dropped. */
+        if_addrs_remove(idx, ifa, family, addr);
+        return -1;
+    }
+
+    nl_object_get(OBJ_CAST(addr));
+    entry->addr = addr;
+    list_add_tail(&entry->head, &ifa->addrs[family]);
+    ifa->count[family]++;
+    idx->addresses++;
+
+    return 0;
+}
+
+void
+addr_index_remove(struct addr_index *idx, struct rtnl_addr *addr)
+{
+    addr_family family = addr_index_family(rtnl_addr_get_family(addr));
+    struct if_addrs *ifa;
+
+    if (ADDR_FAMILY_COUNT == family) {
+        return;
+    }
+
+    ifa = addr_index_find(idx, rtnl_addr_get_ifindex(addr));
+    if (ifa) {
+        if_addrs_remove(idx, ifa, family, addr);
+    }
+}
+
+struct rebuild_arg {
+    struct addr_index *idx;
+    int rc;
+};
+
+static void
+rebuild_cb(struct nl_object *obj, void *data)
+{
+    struct rebuild_arg *arg = data;
+
+    if (addr_index_add(arg->idx, (struct rtnl_addr *) obj)) {
+        arg->rc = -1;
+    }
+}
+
+int
+addr_index_rebuild(struct addr_index *idx, struct nl_cache *cache)
+{
+    struct rebuild_arg arg = { .idx = idx, .rc = 0 };
+
+    addr_index_clear(idx);
+    nl_cache_foreach(cache, rebuild_cb, &arg);
+
+    return arg.rc;
+}
@@ -0,0 +1,92 @@
+#ifndef __ADDRINDEX_H__
+#define __ADDRINDEX_H__
+
+#include <stddef.h>
+#include <libubox/list.h>
+#include <libnl3/netlink/cache.h>
+#include <libnl3/netlink/route/addr.h>
+
+#define ADDR_INDEX_INIT_BUCKETS 64
+#define ADDR_INDEX_MAX_LOAD 2       /* average interfaces per bucket before growing */
+
+/* Address families kept in index. */
+typedef enum addr_family_e {
+    ADDR_FAMILY_INET,
+    ADDR_FAMILY_INET6,
+    ADDR_FAMILY_COUNT,
+} addr_family;
+
+/* One address, reference to cache object is held while in index. */
+struct addr_entry {
+    struct list_head head;
+    struct rtnl_addr *addr;
+};
+
+/* Addresses of one interface, in order they were reported by kernel
+ * (primary address comes before secondaries). */
+struct if_addrs {
+    struct list_head node;          /* hash chain */
+    int ifindex;
+    struct list_head addrs[ADDR_FAMILY_COUNT];
+    size_t count[ADDR_FAMILY_COUNT];
+};
+
+/**
+ * Addresses from route/addr cache indexed by ifindex and family.
+ *
+ * Index mirrors cache, it is updated from cache change callback and
+ * rebuilt whenever cache is refilled.
+ */
+struct addr_index {
+    struct list_head *buckets;
+    size_t size;                    /* number of buckets */
+    size_t interfaces;              /* if_addrs entries */
+    size_t addresses;
+};
+
+#define addr_index_for_each(ENTRY, ADDRS, FAMILY) \
+    list_for_each_entry(ENTRY, &(ADDRS)->addrs[FAMILY], head)
+
+struct addr_index *addr_index_new(void);
+void addr_index_free(struct addr_index *idx);
+
+/**
+ * @brief Drop all addresses from index.
+ */
+void addr_index_clear(struct addr_index *idx);
+
+/**
+ * @brief Replace content of index with all addresses in cache.
+ *
+ * @return 0 on success, -1 on allocation failure (index is left partial).
+ */
+int addr_index_rebuild(struct addr_index *idx, struct nl_cache *cache);
+
+/**
+ * @brief Add address, address identical to it (same interface, local
+ * address and prefix) is replaced.
+ *
+ * @return 0 on success or for families not indexed, -1 on allocation failure.
+ */
+int addr_index_add(struct addr_index *idx, struct rtnl_addr *addr);
+
+/**
+ * @brief Remove address identical to given one.
+ */
+void addr_index_remove(struct addr_index *idx, struct rtnl_addr *addr);
+
+/**
+ * @brief Get addresses of interface.
+ *
+ * @return Addresses or NULL if interface has none.
+ */
+struct if_addrs *addr_index_find(struct addr_index *idx, int ifindex);
+
+/**
+ * @brief Map AF_INET/AF_INET6 to index family.
+ *
+ * @return Index family or ADDR_FAMILY_COUNT for other families.
+ */
+addr_family addr_index_family(int family);
+
+#endif /* __ADDRINDEX_H__ */
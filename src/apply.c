@@ -0,0 +1,401 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "apply.h"
+#include "common.h"
+
+/* Link change plus few address changes fit without growing. */
+#define APPLY_BATCH_INIT_SIZE 8
+
+/* One request of a batch. */
+struct apply_msg {
+    struct nl_msg *msg;
+    unsigned int leaves;            /* leaves applied by message */
+    uint32_t seq;
+    int error;
+};
+
+/* Requests of one interface sent together. */
+struct apply_batch {
+    struct apply_msg *msgs;
+    size_t count;
+    size_t size;
+    size_t pending;                 /* acknowledgements not received */
+    unsigned int dropped;           /* leaves of requests not built */
+};
+
+/* Batch takes ownership of msg. */
+static void
+batch_add(struct apply_batch *batch, struct nl_msg *msg, unsigned int leaves)
+{
+    struct apply_msg *msgs;
+    size_t size;
+
+    if (batch->count == batch->size) {
+        size = batch->size ? batch->size * 2 : APPLY_BATCH_INIT_SIZE;
+        msgs = realloc(batch->msgs, size * sizeof(*msgs));
+        if (!msgs) {
+            nlmsg_free(msg);
+            batch->dropped |= leaves;
+            return;
+        }
+        batch->msgs = msgs;
+        batch->size = size;
+    }
+
+    batch->msgs[batch->count++] = (struct apply_msg) {
+        .msg = msg,
+        .leaves = leaves,
+    };
+}
+
+/* Release requests, allocation is kept for next interface. */
+static void
+batch_reset(struct apply_batch *batch)
+{
+    for (size_t i = 0; i < batch->count; i++) {
+        nlmsg_free(batch->msgs[i].msg);
+    }
+    batch->count = 0;
+    batch->dropped = 0;
+}
+
+static struct apply_batch *
+batch_ack(struct apply_batch *batch, uint32_t seq, int error)
+{
+    for (size_t i = 0; i < batch->count; i++) {
+        if (batch->msgs[i].seq == seq) {
+            batch->msgs[i].error = error;
+            batch->pending--;
+            return batch;
+        }
+    }
+
+    return NULL;
+}
+
+static int
+ack_cb(struct nl_msg *msg, void *arg)
+{
+    batch_ack(arg, nlmsg_hdr(msg)->nlmsg_seq, 0);
+
+    return NL_OK;
+}
+
+static int
+error_cb(struct sockaddr_nl *nla, struct nlmsgerr *err, void *arg)
+{
+    batch_ack(arg, err->msg.nlmsg_seq, err->error);
+
+    return NL_OK;
+}
+
+/* Acknowledgements are matched by sequence number. */
+static int
+seq_cb(struct nl_msg *msg, void *arg)
+{
+    return NL_OK;
+}
+
+/* Build address request, ip and prefix length are taken from address. */
+static struct nl_msg *
+build_addr(int ifindex, int family, const struct ip_address *address, bool add)
+{
+    struct rtnl_addr *addr = NULL;
+    struct nl_addr *local = NULL;
+    struct nl_msg *msg = NULL;
+    int rc;
+
+    if (!address->ip[0] || !address->subnet.prefix_length) {
+        return NULL;
+    }
+
+    rc = nl_addr_parse(address->ip, family, &local);
+    if (rc < 0) {
+        ERR("invalid address %s: %s", address->ip, nl_geterror(rc));
+        return NULL;
+    }
+    nl_addr_set_prefixlen(local, address->subnet.prefix_length);
+
+    addr = rtnl_addr_alloc();
+    if (!addr) {
+        goto exit;
+    }
+    rtnl_addr_set_ifindex(addr, ifindex);
+    rtnl_addr_set_family(addr, family);
+    rtnl_addr_set_local(addr, local);
+    rtnl_addr_set_prefixlen(addr, address->subnet.prefix_length);
+
+    rc = add ? rtnl_addr_build_add_request(addr, NLM_F_REPLACE, &msg)
+             : rtnl_addr_build_delete_request(addr, 0, &msg);
+    if (rc < 0) {
+        ERR("address request for %s: %s", address->ip, nl_geterror(rc));
+        msg = NULL;
+    }
+
+  exit:
+    rtnl_addr_put(addr);
+    nl_addr_put(local);
+
+    return msg;
+}
+
+/* Collect address requests of one family.
+ * Only addresses removed or added by change are sent, address with
+ * changed prefix length is removed and added again. */
+static void
+build_addresses(struct if_change *change, int family, struct apply_batch *batch,
+                struct address_list *added, struct address_list *removed)
+{
+    const struct address_list *old, *add = added;
+    const struct ip_address *address;
+    unsigned int leaves = AF_INET6 == family ? CHANGE_IPV6_ADDRESS : CHANGE_ADDRESS;
+    struct nl_msg *msg;
+
+    if (!(change->leaves & leaves)) {
+        return;
+    }
+
+    if (change_address_diff(change, family, added, removed)) {
+        batch->dropped |= leaves;
+        return;
+    }
+
+    /* Removal failures are not fatal, address may be gone already. */
+    address_list_for_each(address, removed) {
+        msg = build_addr(change->ifindex, family, address, false);
+        if (msg) {
+            batch_add(batch, msg, 0);
+        }
+    }
+
+    /* Without promote_secondaries kernel drops IPv4 secondaries together
+     * with primary address, all remaining addresses are added again then
+     * (replace of an existing one is a no-op). */
+    old = &change->old_addresses;
+    if (AF_INET == family && old->count && address_list_find(removed, old->items[0].ip)) {
+        add = &change->config.addresses;
+    }
+
+    address_list_for_each(address, add) {
+        msg = build_addr(change->ifindex, family, address, true);
+        if (msg) {
+            batch_add(batch, msg, leaves);
+        } else {
+            batch->dropped |= leaves;
+        }
+    }
+
+    if (!add->count) {
+        /* Only removals, nothing can be left for reload. */
+        change->applied |= leaves;
+    }
+}
+
+/* Write IPv6 sysctls of changed leaves.
+ * libnl can not build IFLA_INET6_CONF, values go through procfs. */
+static void
+apply_inet6_conf(struct if_change *change)
+{
+    struct if_config6 *config = &change->config.ipv6;
+    struct autoconf_v6 *autoconf = &config->autoconf;
+    int rc = 0;
+
+    if ((change->leaves & CHANGE_IPV6_ENABLED) &&
+        !set_inet6_conf(change->name, "disable_ipv6", !config->enabled)) {
+        change->applied |= CHANGE_IPV6_ENABLED;
+    }
+
+    if ((change->leaves & CHANGE_IPV6_FORWARDING) &&
+        !set_inet6_conf(change->name, "forwarding", config->forwarding)) {
+        change->applied |= CHANGE_IPV6_FORWARDING;
+    }
+
+    /* Removed MTU has no value to apply, netifd restores default. */
+    if ((change->leaves & CHANGE_IPV6_MTU) && config->mtu &&
+        !set_inet6_conf(change->name, "mtu", config->mtu)) {
+        change->applied |= CHANGE_IPV6_MTU;
+    }
+
+    if ((change->leaves & CHANGE_IPV6_DAD) &&
+        !set_inet6_conf(change->name, "dad_transmits", config->dad_transmits)) {
+        change->applied |= CHANGE_IPV6_DAD;
+    }
+
+    if (change->leaves & CHANGE_IPV6_AUTOCONF) {
+        rc |= set_inet6_conf(change->name, "autoconf", autoconf->create_global_addresses);
+        /* 2 prefers temporary addresses as RFC 4941 intends. */
+        rc |= set_inet6_conf(change->name, "use_tempaddr", autoconf->create_temporary_addresses ? 2 : 0);
+        rc |= set_inet6_conf(change->name, "temp_valid_lft", autoconf->temporary_valid_lifetime);
+        rc |= set_inet6_conf(change->name, "temp_prefered_lft", autoconf->temporary_preffered_lifetime);
+        if (!rc) {
+            change->applied |= CHANGE_IPV6_AUTOCONF;
+        }
+    }
+}
+
+/* Collect requests for changed leaves of one interface. */
+static void
+build_batch(struct function_ctx *fctx, struct if_change *change, struct apply_batch *batch,
+            struct address_list *added, struct address_list *removed)
+{
+    struct if_config *config = &change->config;
+    struct rtnl_link *link = NULL;
+    struct rtnl_link *request = NULL;
+    struct nl_msg *msg = NULL;
+    unsigned int leaves = 0;
+    int rc;
+
+    if (change->leaves & (CHANGE_ENABLED | CHANGE_MTU)) {
+        link = get_link(fctx, change->ifindex);
+        request = rtnl_link_alloc();
+    }
+
+    if (link && request) {
+        if (change->leaves & CHANGE_ENABLED) {
+            if (config->enabled) {
+                rtnl_link_set_flags(request, IFF_UP);
+            } else {
+                rtnl_link_unset_flags(request, IFF_UP);
+            }
+            leaves |= CHANGE_ENABLED;
+        }
+
+        /* Removed MTU has no value to apply, netifd restores default. */
+        if ((change->leaves & CHANGE_MTU) && config->mtu) {
+            rtnl_link_set_mtu(request, config->mtu);
+            leaves |= CHANGE_MTU;
+        }
+
+        if (leaves) {
+            rc = rtnl_link_build_change_request(link, request, 0, &msg);
+            if (rc < 0) {
+                ERR("link request for %s: %s", change->name, nl_geterror(rc));
+            } else {
+                batch_add(batch, msg, leaves);
+            }
+        }
+    }
+
+    rtnl_link_put(request);
+    rtnl_link_put(link);
+
+    build_addresses(change, AF_INET, batch, added, removed);
+    build_addresses(change, AF_INET6, batch, added, removed);
+}
+
+/* Send all requests with one sendmsg and wait for every acknowledgement. */
+static int
+send_batch(struct nl_sock *sk, struct nl_cb *cb, struct apply_batch *batch)
+{
+    struct nlmsghdr *hdr;
+    size_t len = 0;
+    char *buf;
+    int rc = 0;
+
+    for (size_t i = 0; i < batch->count; i++) {
+        nl_complete_msg(sk, batch->msgs[i].msg);
+        hdr = nlmsg_hdr(batch->msgs[i].msg);
+        hdr->nlmsg_flags |= NLM_F_ACK;
+        batch->msgs[i].seq = hdr->nlmsg_seq;
+        batch->msgs[i].error = 0;
+        len += NLMSG_ALIGN(hdr->nlmsg_len);
+    }
+
+    buf = calloc(1, len);
+    if (!buf) {
+        return -NLE_NOMEM;
+    }
+
+    len = 0;
+    for (size_t i = 0; i < batch->count; i++) {
+        hdr = nlmsg_hdr(batch->msgs[i].msg);
+        memcpy(buf + len, hdr, hdr->nlmsg_len);
+        len += NLMSG_ALIGN(hdr->nlmsg_len);
+    }
+
+    rc = nl_sendto(sk, buf, len);
+    free(buf);
+    if (rc < 0) {
+        return rc;
+    }
+
+    batch->pending = batch->count;
+    while (batch->pending) {
+        rc = nl_recvmsgs(sk, cb);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+size_t
+apply_change_set(struct function_ctx *fctx, struct change_set *set)
+{
+    struct apply_batch batch = { 0 };
+    struct address_list added, removed;
+    struct if_change *change;
+    unsigned int failed;
+    struct nl_cb *cb;
+    size_t incomplete = 0;
+    int rc;
+
+    cb = nl_cb_alloc(NL_CB_DEFAULT);
+    if (!cb) {
+        return set->count;
+    }
+    nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, seq_cb, NULL);
+    nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ack_cb, &batch);
+    nl_cb_err(cb, NL_CB_CUSTOM, error_cb, &batch);
+
+    address_list_init(&added);
+    address_list_init(&removed);
+
+    pthread_mutex_lock(&fctx->lock);
+
+    change_set_for_each(change, set) {
+        change->applied = 0;
+
+        build_batch(fctx, change, &batch, &added, &removed);
+        failed = batch.dropped;
+        if (batch.count) {
+            rc = send_batch(fctx->socket, cb, &batch);
+            if (rc < 0) {
+                ERR("netlink apply for %s: %s", change->name, nl_geterror(rc));
+            }
+            for (size_t i = 0; i < batch.count; i++) {
+                if (rc < 0 || batch.msgs[i].error) {
+                    if (rc >= 0) {
+                        WRN("kernel rejected change of %s: %s", change->name,
+                            strerror(-batch.msgs[i].error));
+                    }
+                    failed |= batch.msgs[i].leaves;
+                } else {
+                    change->applied |= batch.msgs[i].leaves;
+                }
+            }
+        }
+        /* Leaf is applied only if all its requests were. */
+        change->applied &= ~failed;
+        batch_reset(&batch);
+
+        if (change->leaves & CHANGE_IPV6) {
+            apply_inet6_conf(change);
+        }
+
+        /* Leaves not part of UCI model, reload would not apply them. */
+        if (change->leaves & ~change->applied & ~APPLY_NO_RELOAD_LEAVES) {
+            incomplete++;
+        }
+    }
+
+    pthread_mutex_unlock(&fctx->lock);
+    nl_cb_put(cb);
+    free(batch.msgs);
+    address_list_free(&added);
+    address_list_free(&removed);
+
+    return incomplete;
+}
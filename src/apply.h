@@ -0,0 +1,30 @@
+#ifndef __APPLY_H__
+#define __APPLY_H__
+
+#include "functions.h"
+#include "changes.h"
+
+/* Leaves apply engine can push to kernel. */
+#define APPLY_LIVE_LEAVES (CHANGE_ENABLED | CHANGE_MTU | CHANGE_ADDRESS | CHANGE_IPV6)
+
+/* Leaves netifd does not configure, reload can not apply them either. */
+#define APPLY_NO_RELOAD_LEAVES (CHANGE_FORWARDING | CHANGE_IPV6_FORWARDING | CHANGE_IPV6_AUTOCONF | \
+                                CHANGE_LINK_TRAP)
+
+/**
+ * @brief Apply changed admin state, MTU, IPv4 and IPv6 addresses and
+ * IPv6 parameters to kernel.
+ *
+ * Requests of one interface are sent in a single netlink message batch
+ * and their acknowledgements are collected together, IPv6 parameters
+ * are written to per interface sysctls. Leaves accepted by
+ * kernel are marked in applied flags of each change, the rest has to be
+ * applied by reloading interface configuration.
+ *
+ * @param[in] fctx Netlink context, its lock is taken.
+ * @param[in,out] set Changes to apply.
+ * @return Number of interfaces with leaves not applied.
+ */
+size_t apply_change_set(struct function_ctx *fctx, struct change_set *set);
+
+#endif /* __APPLY_H__ */
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sysrepo/values.h"
+
+#include "arena.h"
+
+#define ARENA_ALIGN sizeof(void *)
+#define ARENA_MIN_CHUNK 4096
+
+#define ARENA_ALIGN_SIZE(SIZE) (((SIZE) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static struct arena_chunk *
+arena_chunk_new(size_t size)
+{
+    struct arena_chunk *chunk;
+
+    size = size < ARENA_MIN_CHUNK ? ARENA_MIN_CHUNK : ARENA_ALIGN_SIZE(size);
+
+    chunk = malloc(sizeof(*chunk) + size);
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+int
+arena_init(struct oper_arena *arena, size_t values_size, size_t str_size)
+{
+    int rc = SR_ERR_OK;
+
+    memset(arena, 0, sizeof(*arena));
+
+    arena->chunks = arena_chunk_new(str_size);
+    if (!arena->chunks) {
+        return SR_ERR_NOMEM;
+    }
+
+    if (values_size) {
+        rc = sr_new_values(values_size, &arena->values);
+        if (SR_ERR_OK != rc) {
+            arena_release(arena);
+            return rc;
+        }
+        arena->values_size = values_size;
+    }
+
+    return SR_ERR_OK;
+}
+
+char *
+arena_alloc(struct oper_arena *arena, size_t size)
+{
+    struct arena_chunk *chunk = arena->chunks;
+    char *mem;
+
+    size = ARENA_ALIGN_SIZE(size);
+
+    if (!chunk || chunk->size - chunk->used < size) {
+        /* Estimate was too small, continue in a new chunk twice as big. */
+        chunk = arena_chunk_new(arena->chunks ? arena->chunks->size * 2 + size : size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    mem = chunk->data + chunk->used;
+    chunk->used += size;
+
+    return mem;
+}
+
+char *
+arena_printf(struct oper_arena *arena, const char *fmt, ...)
+{
+    struct arena_chunk *chunk = arena->chunks;
+    va_list ap;
+    char *str;
+    int len;
+
+    /* Try to format in place, most strings fit in current chunk. */
+    if (chunk) {
+        va_start(ap, fmt);
+        len = vsnprintf(chunk->data + chunk->used, chunk->size - chunk->used, fmt, ap);
+        va_end(ap);
+        if (len < 0) {
+            return NULL;
+        }
+        if (ARENA_ALIGN_SIZE((size_t) len + 1) <= chunk->size - chunk->used) {
+            return arena_alloc(arena, len + 1);
+        }
+    } else {
+        va_start(ap, fmt);
+        len = vsnprintf(NULL, 0, fmt, ap);
+        va_end(ap);
+        if (len < 0) {
+            return NULL;
+        }
+    }
+
+    str = arena_alloc(arena, len + 1);
+    if (!str) {
+        return NULL;
+    }
+
+    va_start(ap, fmt);
+    vsnprintf(str, len + 1, fmt, ap);
+    va_end(ap);
+
+    return str;
+}
+
+sr_val_t *
+arena_val(struct oper_arena *arena, const char *xpath, sr_type_t type)
+{
+    sr_val_t *val;
+
+    if (!xpath || arena->values_cnt >= arena->values_size) {
+        return NULL;
+    }
+
+    val = &arena->values[arena->values_cnt];
+    if (SR_ERR_OK != sr_val_set_xpath(val, xpath)) {
+        return NULL;
+    }
+    val->type = type;
+    arena->values_cnt++;
+
+    return val;
+}
+
+void
+arena_finish(struct oper_arena *arena, sr_val_t **values, size_t *values_cnt)
+{
+    if (arena->values_cnt) {
+        *values = arena->values;
+        *values_cnt = arena->values_cnt;
+    } else {
+        sr_free_values(arena->values, arena->values_size);
+        *values = NULL;
+        *values_cnt = 0;
+    }
+
+    arena->values = NULL;
+    arena->values_cnt = 0;
+    arena->values_size = 0;
+}
+
+void
+arena_release(struct oper_arena *arena)
+{
+    struct arena_chunk *chunk;
+
+    while (arena->chunks) {
+        chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        free(chunk);
+    }
+
+    if (arena->values) {
+        sr_free_values(arena->values, arena->values_size);
+        arena->values = NULL;
+    }
+    arena->values_cnt = 0;
+    arena->values_size = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <stdarg.h>
+
+#include "sysrepo.h"
+
+/* Estimated length of one operational xpath, used for initial sizing. */
+#define ARENA_XPATH_LEN 128
+
+struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+/**
+ * Per request memory for operational values.
+ *
+ * Value slots are one contiguous array allocated up front, strings
+ * (xpaths, formatted data) are bump allocated from chunks. Chunks are
+ * never moved, so strings stay valid until the arena is released.
+ */
+struct oper_arena {
+    sr_val_t *values;
+    size_t values_cnt;              /* slots handed out */
+    size_t values_size;             /* slots allocated */
+    struct arena_chunk *chunks;     /* newest first */
+};
+
+/**
+ * @brief Allocate value slots and string memory for one request.
+ *
+ * @param[in] values_size Maximal number of values request can produce.
+ * @param[in] str_size Expected size of all strings, arena grows if it is exceeded.
+ * @return SR_ERR_OK or SR_ERR_NOMEM.
+ */
+int arena_init(struct oper_arena *arena, size_t values_size, size_t str_size);
+
+/**
+ * @brief Allocate string memory from arena.
+ */
+char *arena_alloc(struct oper_arena *arena, size_t size);
+
+/**
+ * @brief Format string into arena memory.
+ *
+ * @return Formatted string or NULL if memory could not be allocated.
+ */
+char *arena_printf(struct oper_arena *arena, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Take next value slot and set its xpath and type.
+ *
+ * @return Value slot or NULL if all slots are taken.
+ */
+sr_val_t *arena_val(struct oper_arena *arena, const char *xpath, sr_type_t type);
+
+/**
+ * @brief Hand over filled values to Sysrepo.
+ *
+ * Ownership of value array moves to caller, arena keeps only strings.
+ */
+void arena_finish(struct oper_arena *arena, sr_val_t **values, size_t *values_cnt);
+
+/**
+ * @brief Release all arena memory in one go.
+ */
+void arena_release(struct oper_arena *arena);
+
+#endif /* __ARENA_H__ */
@@ -0,0 +1,885 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "sysrepo/xpath.h"
+
+#include "changes.h"
+#include "registry.h"
+#include "common.h"
+
+#define CHANGES_XPATH_FMT "/%s:interfaces/interface//*"
+#define VERIFY_XPATH_FMT "/ietf-interfaces:interfaces/interface[name='%s']/ietf-ip:%s/%s"
+
+#define MIN_MTU6 1280
+
+void
+change_set_init(struct change_set *set)
+{
+    INIT_LIST_HEAD(&set->changes);
+    set->count = 0;
+}
+
+static void
+change_free(struct if_change *change)
+{
+    free(change->section);
+    address_list_free(&change->config.addresses);
+    address_list_free(&change->config.ipv6.addresses);
+    address_list_free(&change->old_addresses);
+    address_list_free(&change->old_addresses6);
+    free(change);
+}
+
+void
+change_set_free(struct change_set *set)
+{
+    struct if_change *change, *tmp;
+
+    list_for_each_entry_safe(change, tmp, &set->changes, head) {
+        list_del(&change->head);
+        change_free(change);
+    }
+    set->count = 0;
+}
+
+/* Changes come grouped by interface, last entry is checked first. */
+static struct if_change *
+change_set_find(struct change_set *set, int ifindex)
+{
+    struct if_change *change;
+
+    if (!list_empty(&set->changes)) {
+        change = list_last_entry(&set->changes, struct if_change, head);
+        if (change->ifindex == ifindex) {
+            return change;
+        }
+    }
+
+    change_set_for_each(change, set) {
+        if (change->ifindex == ifindex) {
+            return change;
+        }
+    }
+
+    return NULL;
+}
+
+/* Address lists of change for given family.
+ * Returns CHANGE_* flags of address leaves of that family. */
+static unsigned int
+change_lists(struct if_change *change, int family, struct address_list **old, struct address_list **new)
+{
+    if (AF_INET6 == family) {
+        *old = &change->old_addresses6;
+        *new = &change->config.ipv6.addresses;
+        return CHANGE_IPV6_ADDRESS;
+    }
+
+    *old = &change->old_addresses;
+    *new = &change->config.addresses;
+    return CHANGE_ADDRESS;
+}
+
+/* Current configuration of interface from run-time model.
+ * Addresses are not copied, see change_addresses. */
+static void
+model_config(struct if_interface *iface, struct if_config *config)
+{
+    struct ip_v4 *ipv4 = iface->proto.ipv4;
+    struct ip_v6 *ipv6 = iface->proto.ipv6;
+
+    *config = (struct if_config) {
+        .enabled = ipv4->enabled,
+        .forwarding = ipv4->forwarding,
+        .origin = ipv4->origin,
+        .mtu = ipv4->mtu,
+        .link_trap = iface->link_trap,
+    };
+
+    if (ipv6) {
+        config->ipv6 = (struct if_config6) {
+            .enabled = ipv6->enabled,
+            .forwarding = ipv6->forwarding,
+            .mtu = ipv6->mtu,
+            .dad_transmits = ipv6->dup_addr_detect_transmits,
+            .autoconf = ipv6->autoconf,
+        };
+    }
+}
+
+static struct if_change *
+change_set_get(struct change_set *set, struct if_interface *iface)
+{
+    struct if_change *change;
+
+    change = change_set_find(set, iface->ifindex);
+    if (change) {
+        return change;
+    }
+
+    change = calloc(1, sizeof(*change));
+    if (!change) {
+        return NULL;
+    }
+    if (iface->type) {
+        change->section = strdup(iface->type);
+        if (!change->section) {
+            free(change);
+            return NULL;
+        }
+    }
+    change->ifindex = iface->ifindex;
+    snprintf(change->name, sizeof(change->name), "%s", iface->name);
+    model_config(iface, &change->config);
+    list_add_tail(&change->head, &set->changes);
+    set->count++;
+
+    return change;
+}
+
+/* Copy values of given leaves, addresses are handled by caller. */
+static void
+config_copy(struct if_config *dst, const struct if_config *src, unsigned int leaves)
+{
+    if (leaves & CHANGE_ENABLED) {
+        dst->enabled = src->enabled;
+    }
+    if (leaves & CHANGE_FORWARDING) {
+        dst->forwarding = src->forwarding;
+    }
+    if (leaves & CHANGE_ORIGIN) {
+        dst->origin = src->origin;
+    }
+    if (leaves & CHANGE_MTU) {
+        dst->mtu = src->mtu;
+    }
+    if (leaves & CHANGE_LINK_TRAP) {
+        dst->link_trap = src->link_trap;
+    }
+    if (leaves & CHANGE_IPV6_ENABLED) {
+        dst->ipv6.enabled = src->ipv6.enabled;
+    }
+    if (leaves & CHANGE_IPV6_FORWARDING) {
+        dst->ipv6.forwarding = src->ipv6.forwarding;
+    }
+    if (leaves & CHANGE_IPV6_MTU) {
+        dst->ipv6.mtu = src->ipv6.mtu;
+    }
+    if (leaves & CHANGE_IPV6_DAD) {
+        dst->ipv6.dad_transmits = src->ipv6.dad_transmits;
+    }
+    if (leaves & CHANGE_IPV6_AUTOCONF) {
+        dst->ipv6.autoconf = src->ipv6.autoconf;
+    }
+}
+
+/* Addresses are diffed against the ones before first change, list of
+ * later change already includes earlier changes. */
+static void
+merge_addresses(struct if_change *prev, struct if_change *change, int family)
+{
+    struct address_list *prev_old, *prev_new, *old, *new;
+    unsigned int leaves;
+
+    leaves = change_lists(prev, family, &prev_old, &prev_new);
+    change_lists(change, family, &old, &new);
+
+    if (!(change->leaves & leaves)) {
+        return;
+    }
+    if (!(prev->leaves & leaves)) {
+        address_list_move(prev_old, old);
+    }
+    address_list_move(prev_new, new);
+}
+
+void
+change_set_merge(struct change_set *dst, struct change_set *src)
+{
+    struct if_change *change, *tmp, *prev;
+
+    list_for_each_entry_safe(change, tmp, &src->changes, head) {
+        list_del(&change->head);
+
+        prev = change_set_find(dst, change->ifindex);
+        if (!prev) {
+            list_add_tail(&change->head, &dst->changes);
+            dst->count++;
+            continue;
+        }
+
+        merge_addresses(prev, change, AF_INET);
+        merge_addresses(prev, change, AF_INET6);
+        config_copy(&prev->config, &change->config, change->leaves);
+        prev->leaves |= change->leaves;
+
+        /* Interface could have been renamed in between. */
+        memcpy(prev->name, change->name, sizeof(prev->name));
+        free(prev->section);
+        prev->section = change->section;
+        change->section = NULL;
+        change_free(change);
+    }
+
+    src->count = 0;
+}
+
+/* Find which tracked ipv6 leaf given node is. */
+static unsigned int
+change_leaf6(const char *xpath, const char *leaf)
+{
+    if (strstr(xpath, "/autoconf/")) {
+        return CHANGE_IPV6_AUTOCONF;
+    }
+    if (!strcmp(leaf, "enabled")) {
+        return CHANGE_IPV6_ENABLED;
+    }
+    if (!strcmp(leaf, "forwarding")) {
+        return CHANGE_IPV6_FORWARDING;
+    }
+    if (!strcmp(leaf, "mtu")) {
+        return CHANGE_IPV6_MTU;
+    }
+    if (!strcmp(leaf, "dup-addr-detect-transmits")) {
+        return CHANGE_IPV6_DAD;
+    }
+    if (!strcmp(leaf, "address")) {
+        return CHANGE_IPV6_IP;
+    }
+    if (!strcmp(leaf, "ip") && strstr(xpath, "/address[")) {
+        return CHANGE_IPV6_IP;
+    }
+    if (!strcmp(leaf, "prefix-length") && strstr(xpath, "/address[")) {
+        return CHANGE_IPV6_PREFIX_LENGTH;
+    }
+
+    return 0;
+}
+
+/* Find which tracked leaf xpath points to.
+ * Returns CHANGE_* flag of the leaf or 0 if leaf is not tracked. */
+static unsigned int
+change_leaf(const char *xpath)
+{
+    char *leaf;
+    bool ipv6 = false;
+
+    if (strstr(xpath, "/ietf-ip:ipv6/")) {
+        ipv6 = true;
+    } else if (!strstr(xpath, "/ietf-ip:ipv4/")) {
+        leaf = sr_xpath_node_name(xpath);
+        return leaf && !strcmp(leaf, "link-up-down-trap-enable") ? CHANGE_LINK_TRAP : 0;
+    }
+
+    leaf = sr_xpath_node_name(xpath);
+    if (!leaf) {
+        return 0;
+    }
+
+    if (ipv6) {
+        return change_leaf6(xpath, leaf);
+    }
+
+    if (!strcmp(leaf, "enabled")) {
+        return CHANGE_ENABLED;
+    }
+    if (!strcmp(leaf, "forwarding")) {
+        return CHANGE_FORWARDING;
+    }
+    if (!strcmp(leaf, "origin")) {
+        return CHANGE_ORIGIN;
+    }
+    if (!strcmp(leaf, "mtu")) {
+        return CHANGE_MTU;
+    }
+    if (!strcmp(leaf, "address")) {
+        return CHANGE_IP;
+    }
+    if (!strcmp(leaf, "ip") && strstr(xpath, "/address[")) {
+        return CHANGE_IP;
+    }
+    if (!strcmp(leaf, "prefix-length") && strstr(xpath, "/address[")) {
+        return CHANGE_PREFIX_LENGTH;
+    }
+
+    return 0;
+}
+
+/* Copy value of key of given list node from xpath to buffer.
+ * Returns 0 on success, -1 if there is no such key or it does not fit. */
+static int
+xpath_key(const char *node_xpath, char *node, char *key, char *buf, size_t size)
+{
+    sr_xpath_ctx_t state = { 0 };
+    char *xpath;
+    char *value;
+    int len = -1;
+
+    buf[0] = '\0';
+
+    /* Key lookup modifies xpath in place. */
+    xpath = strdup(node_xpath);
+    if (!xpath) {
+        return -1;
+    }
+
+    value = sr_xpath_key_value(xpath, node, key, &state);
+    if (value) {
+        len = snprintf(buf, size, "%s", value);
+    }
+
+    sr_xpath_recover(&state);
+    free(xpath);
+
+    return (len < 0 || (size_t) len >= size) ? -1 : 0;
+}
+
+/* Start tracking addresses of interface on its first address change. */
+static int
+change_addresses(struct if_change *change, struct if_interface *iface, int family)
+{
+    struct address_list *old, *new, *model;
+    unsigned int leaves;
+
+    leaves = change_lists(change, family, &old, &new);
+    if (change->leaves & leaves) {
+        return 0;
+    }
+
+    model = AF_INET6 == family ? &iface->proto.ipv6->addresses : &iface->proto.ipv4->addresses;
+    if (address_list_copy(old, model) || address_list_copy(new, model)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Store address list entry change. */
+static int
+change_store_address(struct if_change *change, struct if_interface *iface, int family, bool key,
+                     const char *xpath, const sr_val_t *val)
+{
+    struct address_list *old, *addresses;
+    struct ip_address *address;
+    char ip[ADDRESS_IP_LEN];
+    unsigned char bin[sizeof(struct in6_addr)];
+
+    if (xpath_key(xpath, "address", "ip", ip, sizeof(ip))) {
+        WRN("No IP address in %s", xpath);
+        return SR_ERR_OK;
+    }
+    /* IPv6 address has more textual forms, list is keyed by canonical one. */
+    if (AF_INET6 == family && 1 == inet_pton(AF_INET6, ip, bin)) {
+        inet_ntop(AF_INET6, bin, ip, sizeof(ip));
+    }
+
+    if (change_addresses(change, iface, family)) {
+        return SR_ERR_NOMEM;
+    }
+    change_lists(change, family, &old, &addresses);
+
+    /* Removing entry or its key removes address. */
+    if (key && !val) {
+        address_list_remove(addresses, ip);
+        return SR_ERR_OK;
+    }
+
+    address = address_list_find(addresses, ip);
+    if (!address) {
+        address = address_list_add(addresses, ip, 0);
+        if (!address) {
+            return SR_ERR_NOMEM;
+        }
+    }
+    if (!key) {
+        address->subnet.prefix_length = val ? val->data.uint8_val : 0;
+    }
+
+    return SR_ERR_OK;
+}
+
+/* Store one autoconf leaf, val is NULL if leaf was deleted. */
+static void
+change_store_autoconf(struct autoconf_v6 *autoconf, const char *xpath, const sr_val_t *val)
+{
+    char *leaf = sr_xpath_node_name(xpath);
+
+    if (!leaf) {
+        return;
+    }
+
+    /* Defaults of ietf-ip. */
+    if (!strcmp(leaf, "create-global-addresses")) {
+        autoconf->create_global_addresses = val ? val->data.bool_val : true;
+    } else if (!strcmp(leaf, "create-temporary-addresses")) {
+        autoconf->create_temporary_addresses = val ? val->data.bool_val : false;
+    } else if (!strcmp(leaf, "temporary-valid-lifetime")) {
+        autoconf->temporary_valid_lifetime = val ? val->data.uint32_val : 604800;
+    } else if (!strcmp(leaf, "temporary-preferred-lifetime")) {
+        autoconf->temporary_preffered_lifetime = val ? val->data.uint32_val : 86400;
+    }
+}
+
+/* Store one leaf value to change, val is NULL if leaf was deleted. */
+static int
+change_store(struct if_change *change, struct if_interface *iface, unsigned int leaf,
+             const char *xpath, const sr_val_t *val)
+{
+    struct if_config *config = &change->config;
+
+    switch (leaf) {
+    case CHANGE_ENABLED:
+        config->enabled = val ? val->data.bool_val : true;
+        break;
+    case CHANGE_FORWARDING:
+        config->forwarding = val ? val->data.bool_val : false;
+        break;
+    case CHANGE_ORIGIN:
+        config->origin = val ? string_to_origin(val->data.enum_val) : IP_ADDR_ORIGIN_OTHER;
+        break;
+    case CHANGE_MTU:
+        config->mtu = val ? val->data.uint16_val : 0;
+        break;
+    case CHANGE_LINK_TRAP:
+        /* Default is enabled. */
+        config->link_trap = !val || strcmp(val->data.enum_val, "disabled");
+        break;
+    case CHANGE_IP:
+    case CHANGE_PREFIX_LENGTH:
+        return change_store_address(change, iface, AF_INET, CHANGE_IP == leaf, xpath, val);
+    case CHANGE_IPV6_ENABLED:
+        config->ipv6.enabled = val ? val->data.bool_val : true;
+        break;
+    case CHANGE_IPV6_FORWARDING:
+        config->ipv6.forwarding = val ? val->data.bool_val : false;
+        break;
+    case CHANGE_IPV6_MTU:
+        config->ipv6.mtu = val ? val->data.uint32_val : 0;
+        break;
+    case CHANGE_IPV6_DAD:
+        config->ipv6.dad_transmits = val ? val->data.uint32_val : 1;
+        break;
+    case CHANGE_IPV6_AUTOCONF:
+        change_store_autoconf(&config->ipv6.autoconf, xpath, val);
+        break;
+    case CHANGE_IPV6_IP:
+    case CHANGE_IPV6_PREFIX_LENGTH:
+        return change_store_address(change, iface, AF_INET6, CHANGE_IPV6_IP == leaf, xpath, val);
+    default:
+        break;
+    }
+
+    return SR_ERR_OK;
+}
+
+/* Find interface the changed node belongs to.
+ * Name is copied to buffer if node belongs to some interface. */
+static struct if_interface *
+change_interface(struct if_registry *registry, const char *node_xpath, char *name_buf, size_t size)
+{
+    if (xpath_key(node_xpath, "interface", "name", name_buf, size)) {
+        return NULL;
+    }
+
+    return registry_find_name(registry, name_buf);
+}
+
+int
+change_set_build(sr_session_ctx_t *session, const char *module_name,
+                 struct if_registry *registry, struct change_set *set, bool verify)
+{
+    char change_path[XPATH_MAX_LEN];
+    char name[XPATH_MAX_LEN];
+    sr_change_iter_t *it = NULL;
+    sr_change_oper_t oper;
+    sr_val_t *old_value = NULL;
+    sr_val_t *new_value = NULL;
+    const sr_val_t *node;
+    struct if_interface *iface;
+    struct if_change *change;
+    unsigned int leaf;
+    int rc = SR_ERR_OK;
+
+    snprintf(change_path, sizeof(change_path), CHANGES_XPATH_FMT, module_name);
+
+    rc = sr_get_changes_iter(session, change_path, &it);
+    SR_CHECK_RET(rc, exit, "sr_get_changes_iter %s: %s", change_path, sr_strerror(rc));
+
+    while (SR_ERR_OK == (rc = sr_get_change_next(session, it, &oper, &old_value, &new_value))) {
+        node = new_value ? new_value : old_value;
+        if (!node || !node->xpath) {
+            goto next;
+        }
+
+        leaf = change_leaf(node->xpath);
+        if (!leaf && !verify) {
+            goto next;
+        }
+
+        iface = change_interface(registry, node->xpath, name, sizeof(name));
+        if (!iface) {
+            if (verify && name[0] && SR_OP_DELETED != oper) {
+                /* Interfaces are not created by plugin. */
+                ERR("Interface %s does not exist", name);
+                sr_set_error(session, "Interface does not exist", node->xpath);
+                rc = SR_ERR_VALIDATION_FAILED;
+                goto exit;
+            }
+            if (name[0] && leaf) {
+                WRN("Interface %s not present, change skipped", name);
+            }
+            goto next;
+        }
+
+        if (!leaf || !iface->proto.ipv4 || ((leaf & CHANGE_IPV6) && !iface->proto.ipv6)) {
+            goto next;
+        }
+
+        change = change_set_get(set, iface);
+        if (!change) {
+            rc = SR_ERR_NOMEM;
+            goto exit;
+        }
+
+        rc = change_store(change, iface, leaf, node->xpath, SR_OP_DELETED == oper ? NULL : new_value);
+        if (SR_ERR_OK != rc) {
+            goto exit;
+        }
+        change->leaves |= leaf;
+
+      next:
+        sr_free_val(old_value);
+        sr_free_val(new_value);
+        old_value = NULL;
+        new_value = NULL;
+    }
+
+    if (SR_ERR_NOT_FOUND == rc) {
+        /* End of changes. */
+        rc = SR_ERR_OK;
+    }
+
+  exit:
+    sr_free_val(old_value);
+    sr_free_val(new_value);
+    if (it) {
+        sr_free_change_iter(it);
+    }
+
+    return rc;
+}
+
+void
+change_set_store(struct change_set *set, struct if_registry *registry)
+{
+    struct if_change *change;
+    struct if_interface *iface;
+    struct if_config config;
+    struct ip_v4 *ipv4;
+    struct ip_v6 *ipv6;
+
+    change_set_for_each(change, set) {
+        iface = registry_find_index(registry, change->ifindex);
+        if (!iface || !iface->proto.ipv4) {
+            continue;
+        }
+
+        ipv4 = iface->proto.ipv4;
+        ipv6 = iface->proto.ipv6;
+        model_config(iface, &config);
+        config_copy(&config, &change->config, change->leaves);
+
+        ipv4->enabled = config.enabled;
+        ipv4->forwarding = config.forwarding;
+        ipv4->origin = config.origin;
+        ipv4->mtu = config.mtu;
+        iface->link_trap = config.link_trap;
+
+        if ((change->leaves & CHANGE_ADDRESS) &&
+            address_list_copy(&ipv4->addresses, &change->config.addresses)) {
+            ERR("Can't store addresses of %s", change->name);
+        }
+
+        if (!ipv6) {
+            continue;
+        }
+
+        ipv6->enabled = config.ipv6.enabled;
+        ipv6->forwarding = config.ipv6.forwarding;
+        ipv6->mtu = config.ipv6.mtu;
+        ipv6->dup_addr_detect_transmits = config.ipv6.dad_transmits;
+        ipv6->autoconf = config.ipv6.autoconf;
+
+        if ((change->leaves & CHANGE_IPV6_ADDRESS) &&
+            address_list_copy(&ipv6->addresses, &change->config.ipv6.addresses)) {
+            ERR("Can't store IPv6 addresses of %s", change->name);
+        }
+    }
+}
+
+/* Report validation error for one leaf of interface. */
+static int
+verify_error(sr_session_ctx_t *session, const char *ifname, int family, const char *leaf, const char *msg)
+{
+    char xpath[XPATH_MAX_LEN + IF_NAMESIZE];
+
+    snprintf(xpath, sizeof(xpath), VERIFY_XPATH_FMT, ifname, AF_INET6 == family ? "ipv6" : "ipv4", leaf);
+    ERR("%s: %s", xpath, msg);
+    sr_set_error(session, msg, xpath);
+
+    return SR_ERR_VALIDATION_FAILED;
+}
+
+/* Check that IPv4 address can be assigned to an interface. */
+static const char *
+verify_address(const struct ip_address *address)
+{
+    struct in_addr in;
+    uint32_t host, mask;
+    uint8_t prefix = address->subnet.prefix_length;
+
+    if (1 != inet_pton(AF_INET, address->ip, &in)) {
+        return "Invalid IPv4 address";
+    }
+    if (prefix < 1 || prefix > 32) {
+        return "Prefix length must be from 1 to 32";
+    }
+
+    host = ntohl(in.s_addr);
+    if (0 == host || INADDR_BROADCAST == host) {
+        return "Unspecified or broadcast address";
+    }
+    if (IN_MULTICAST(host)) {
+        return "Multicast address";
+    }
+
+    /* Point-to-point /31 and host /32 have no network and broadcast. */
+    if (prefix <= 30) {
+        mask = ~0u >> prefix;
+        if (0 == (host & mask) || mask == (host & mask)) {
+            return "Network or broadcast address of its subnet";
+        }
+    }
+
+    return NULL;
+}
+
+/* Check that IPv6 address can be assigned to an interface. */
+static const char *
+verify_address6(const struct ip_address *address)
+{
+    struct in6_addr in;
+    uint8_t prefix = address->subnet.prefix_length;
+
+    if (1 != inet_pton(AF_INET6, address->ip, &in)) {
+        return "Invalid IPv6 address";
+    }
+    if (prefix < 1 || prefix > 128) {
+        return "Prefix length must be from 1 to 128";
+    }
+    if (IN6_IS_ADDR_UNSPECIFIED(&in) || IN6_IS_ADDR_LOOPBACK(&in)) {
+        return "Unspecified or loopback address";
+    }
+    if (IN6_IS_ADDR_MULTICAST(&in)) {
+        return "Multicast address";
+    }
+    if (IN6_IS_ADDR_V4MAPPED(&in)) {
+        return "IPv4-mapped address";
+    }
+
+    return NULL;
+}
+
+/* Address added to an interface by change set. */
+struct verify_added {
+    const char *ip;
+    int family;
+    struct if_change *change;
+};
+
+static int
+verify_added_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct verify_added *) a)->ip, ((const struct verify_added *) b)->ip);
+}
+
+/* Addresses of given family interface will have once set is applied. */
+static const struct address_list *
+effective_addresses(struct change_set *set, struct if_interface *iface, int family)
+{
+    struct if_change *change = change_set_find(set, iface->ifindex);
+    struct address_list *old, *new;
+    unsigned int leaves;
+
+    if (change) {
+        leaves = change_lists(change, family, &old, &new);
+        if (change->leaves & leaves) {
+            return new;
+        }
+    }
+
+    if (AF_INET6 == family) {
+        return iface->proto.ipv6 ? &iface->proto.ipv6->addresses : NULL;
+    }
+
+    return &iface->proto.ipv4->addresses;
+}
+
+/* Check added addresses are not used by other interfaces.
+ * Added addresses are sorted so all interfaces are checked in one pass
+ * over registry. Textual forms of both families never collide. */
+static int
+verify_unique(sr_session_ctx_t *session, struct change_set *set, struct if_registry *registry,
+              struct verify_added *added, size_t count)
+{
+    static const int families[] = { AF_INET, AF_INET6 };
+    const struct address_list *addresses;
+    struct verify_added key, *found;
+    struct ip_address *address;
+    struct if_interface *iface;
+
+    qsort(added, count, sizeof(*added), verify_added_cmp);
+    for (size_t i = 1; i < count; i++) {
+        if (!strcmp(added[i - 1].ip, added[i].ip)) {
+            return verify_error(session, added[i].change->name, added[i].family, "address",
+                                "Address added to more interfaces");
+        }
+    }
+
+    registry_for_each(iface, registry) {
+        if (!iface->proto.ipv4) {
+            continue;
+        }
+        for (size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++) {
+            addresses = effective_addresses(set, iface, families[f]);
+            if (!addresses) {
+                continue;
+            }
+            address_list_for_each(address, addresses) {
+                key.ip = address->ip;
+                found = bsearch(&key, added, count, sizeof(*added), verify_added_cmp);
+                if (found && found->change->ifindex != iface->ifindex) {
+                    return verify_error(session, found->change->name, found->family, "address",
+                                        "Address already used by another interface");
+                }
+            }
+        }
+    }
+
+    return SR_ERR_OK;
+}
+
+/* Check scalar leaves of one change. */
+static int
+verify_leaves(sr_session_ctx_t *session, struct if_change *change)
+{
+    if ((change->leaves & CHANGE_MTU) && change->config.mtu &&
+        (change->config.mtu < MIN_MTU || change->config.mtu > MAX_MTU)) {
+        return verify_error(session, change->name, AF_INET, "mtu", "MTU out of supported range");
+    }
+
+    if ((change->leaves & CHANGE_IPV6_MTU) && change->config.ipv6.mtu &&
+        (change->config.ipv6.mtu < MIN_MTU6 || change->config.ipv6.mtu > UINT16_MAX)) {
+        return verify_error(session, change->name, AF_INET6, "mtu", "MTU out of supported range");
+    }
+
+    return SR_ERR_OK;
+}
+
+int
+change_set_verify(sr_session_ctx_t *session, struct change_set *set, struct if_registry *registry)
+{
+    static const int families[] = { AF_INET, AF_INET6 };
+    struct address_list diff_added, diff_removed;
+    struct verify_added *added = NULL, *tmp;
+    struct address_list *old, *new;
+    struct ip_address *address;
+    struct if_change *change;
+    size_t count = 0, size = 0;
+    struct in6_addr in6;
+    const char *msg;
+    int family;
+    int rc = SR_ERR_OK;
+
+    address_list_init(&diff_added);
+    address_list_init(&diff_removed);
+
+    change_set_for_each(change, set) {
+        rc = verify_leaves(session, change);
+        if (SR_ERR_OK != rc) {
+            goto exit;
+        }
+
+        for (size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++) {
+            family = families[f];
+            if (change_address_diff(change, family, &diff_added, &diff_removed)) {
+                rc = SR_ERR_NOMEM;
+                goto exit;
+            }
+
+            /* Addresses interface already has are not checked again. */
+            address_list_for_each(address, &diff_added) {
+                msg = AF_INET6 == family ? verify_address6(address) : verify_address(address);
+                if (msg) {
+                    rc = verify_error(session, change->name, family, "address", msg);
+                    goto exit;
+                }
+            }
+
+            if (count + diff_added.count > size) {
+                size = (count + diff_added.count) * 2;
+                tmp = realloc(added, size * sizeof(*added));
+                if (!tmp) {
+                    rc = SR_ERR_NOMEM;
+                    goto exit;
+                }
+                added = tmp;
+            }
+
+            /* Entries point to change, diff lists are reused. */
+            change_lists(change, family, &old, &new);
+            address_list_for_each(address, &diff_added) {
+                /* Same link-local address is valid on every link. */
+                if (AF_INET6 == family && 1 == inet_pton(AF_INET6, address->ip, &in6) &&
+                    IN6_IS_ADDR_LINKLOCAL(&in6)) {
+                    continue;
+                }
+                added[count].ip = address_list_find(new, address->ip)->ip;
+                added[count].family = family;
+                added[count].change = change;
+                count++;
+            }
+        }
+    }
+
+    if (count) {
+        rc = verify_unique(session, set, registry, added, count);
+    }
+
+  exit:
+    free(added);
+    address_list_free(&diff_added);
+    address_list_free(&diff_removed);
+
+    return rc;
+}
+
+int
+change_address_diff(struct if_change *change, int family, struct address_list *added,
+                    struct address_list *removed)
+{
+    struct address_list *old, *new;
+    unsigned int leaves;
+
+    leaves = change_lists(change, family, &old, &new);
+    if (!(change->leaves & leaves)) {
+        added->count = 0;
+        removed->count = 0;
+        return 0;
+    }
+
+    return address_list_diff(old, new, added, removed);
+}
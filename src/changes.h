@@ -0,0 +1,135 @@
+#ifndef __CHANGES_H__
+#define __CHANGES_H__
+
+#include <stddef.h>
+#include <libubox/list.h>
+
+#include "sysrepo.h"
+#include "network.h"
+
+struct if_registry;
+
+/* Configuration leaves tracked per interface. */
+#define CHANGE_ENABLED          (1 << 0)
+#define CHANGE_FORWARDING       (1 << 1)
+#define CHANGE_ORIGIN           (1 << 2)
+#define CHANGE_MTU              (1 << 3)
+#define CHANGE_IP               (1 << 4)
+#define CHANGE_PREFIX_LENGTH    (1 << 5)
+#define CHANGE_LINK_TRAP        (1 << 6)    /* link-up-down-trap-enable, plugin only */
+
+#define CHANGE_IPV6_ENABLED         (1 << 8)
+#define CHANGE_IPV6_FORWARDING      (1 << 9)
+#define CHANGE_IPV6_MTU             (1 << 10)
+#define CHANGE_IPV6_IP              (1 << 11)
+#define CHANGE_IPV6_PREFIX_LENGTH   (1 << 12)
+#define CHANGE_IPV6_DAD             (1 << 13)
+#define CHANGE_IPV6_AUTOCONF        (1 << 14)   /* any leaf of autoconf */
+
+/* Address list is tracked as a whole. */
+#define CHANGE_ADDRESS          (CHANGE_IP | CHANGE_PREFIX_LENGTH)
+#define CHANGE_IPV6_ADDRESS     (CHANGE_IPV6_IP | CHANGE_IPV6_PREFIX_LENGTH)
+
+#define CHANGE_IPV6             (CHANGE_IPV6_ENABLED | CHANGE_IPV6_FORWARDING | CHANGE_IPV6_MTU | \
+                                 CHANGE_IPV6_ADDRESS | CHANGE_IPV6_DAD | CHANGE_IPV6_AUTOCONF)
+
+/* Configured IPv6 values of one interface. */
+struct if_config6 {
+    bool enabled;
+    bool forwarding;
+    uint32_t mtu;
+    uint32_t dad_transmits;
+    struct autoconf_v6 autoconf;
+    struct address_list addresses;
+};
+
+/* Configured values of one interface.
+ * Address lists are filled only if addresses changed. */
+struct if_config {
+    bool enabled;
+    bool forwarding;
+    ip_addr_origin origin;
+    uint16_t mtu;
+    bool link_trap;
+    struct address_list addresses;
+    struct if_config6 ipv6;
+};
+
+/* Changed leaves of one interface.
+ * Values are copied, change does not refer to registry entry so it can
+ * outlive the interface and be handled by another thread. */
+struct if_change {
+    struct list_head head;
+    int ifindex;
+    char name[IF_NAMESIZE];
+    char *section;                  /* UCI section, NULL if there is none */
+    unsigned int leaves;            /* CHANGE_* flags */
+    unsigned int applied;           /* leaves already applied to kernel */
+    struct if_config config;        /* values after change */
+    struct address_list old_addresses;  /* addresses before first address change */
+    struct address_list old_addresses6;
+};
+
+/**
+ * Minimal set of changes made by one sysrepo change event.
+ */
+struct change_set {
+    struct list_head changes;
+    size_t count;                   /* number of interfaces changed */
+};
+
+#define change_set_for_each(CHANGE, SET) \
+    list_for_each_entry(CHANGE, &(SET)->changes, head)
+
+void change_set_init(struct change_set *set);
+
+/**
+ * @brief Build change set from changes of given module.
+ *
+ * Run-time model is not modified, see change_set_store. Changes of
+ * interfaces not present in registry are skipped, or rejected in verify
+ * mode unless they delete configuration.
+ *
+ * @return SR_ERR_OK on success, sysrepo error code otherwise.
+ */
+int change_set_build(sr_session_ctx_t *session, const char *module_name,
+                     struct if_registry *registry, struct change_set *set, bool verify);
+
+/**
+ * @brief Store new values from change set to run-time model.
+ */
+void change_set_store(struct change_set *set, struct if_registry *registry);
+
+/**
+ * @brief Check values of change set before they are applied.
+ *
+ * MTU range, address and prefix sanity and address uniqueness across
+ * interfaces are checked against registry only, kernel and UCI are not
+ * consulted. First problem found is reported to session.
+ *
+ * @return SR_ERR_OK if set can be applied, SR_ERR_VALIDATION_FAILED otherwise.
+ */
+int change_set_verify(sr_session_ctx_t *session, struct change_set *set, struct if_registry *registry);
+
+void change_set_free(struct change_set *set);
+
+/**
+ * @brief Compute addresses of given family change removes and adds.
+ *
+ * Lists are empty if addresses of interface did not change.
+ *
+ * @param[in] family AF_INET or AF_INET6.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int change_address_diff(struct if_change *change, int family, struct address_list *added,
+                        struct address_list *removed);
+
+/**
+ * @brief Move changes from src to dst, src is left empty.
+ *
+ * Changes of the same interface are merged, for leaves changed in both
+ * sets value from src wins.
+ */
+void change_set_merge(struct change_set *dst, struct change_set *src);
+
+#endif /* __CHANGES_H__ */
@@ -1,29 +1,32 @@
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <arpa/inet.h>
+#include <net/if_arp.h>
+#include <linux/if.h>
 
 #include "functions.h"
+#include "addrindex.h"
+#include "router.h"
+#include "neighindex.h"
 #include "uci.h"
 #include "common.h"
 
 #define ADDR_STR_BUF_SIZE 80
 
-
-/* char * */
-/* get_ip4(struct function_ctx *ctx, struct rtnl_link *link); */
-
 static int
 socket_init(struct nl_sock **socket, int protocol)
 {
     int error = 0;
 
     *socket = nl_socket_alloc();
-    if (socket == NULL) {
+    if (*socket == NULL) {
         ERR_MSG("unable to allocate netlink socket for route family.");
+        return -NLE_NOMEM;
     }
 
     error = nl_connect(*socket, protocol);
@@ -35,122 +38,420 @@ socket_init(struct nl_sock **socket, int protocol)
     return 0;
   error:
     nl_socket_free(*socket);
+    *socket = NULL;
 
     return error;
 }
 
+/* Forward changes made by cache manager to registered callback. */
+static void
+link_cache_change(struct nl_cache *cache, struct nl_object *obj, int action, void *data)
+{
+    struct function_ctx *ctx = data;
+
+    ctx->dirty |= FCTX_DIRTY_LINK;
+    if (ctx->link_change) {
+        ctx->link_change((struct rtnl_link *) obj, action, ctx->link_change_arg);
+    }
+}
+
+/* Keep address index in line with address cache. */
+static void
+addr_cache_change(struct nl_cache *cache, struct nl_object *obj, int action, void *data)
+{
+    struct function_ctx *ctx = data;
+    struct rtnl_addr *addr = (struct rtnl_addr *) obj;
+
+    ctx->dirty |= FCTX_DIRTY_LINK;
+    if (NL_ACT_DEL == action) {
+        addr_index_remove(ctx->addrs, addr);
+    } else if (addr_index_add(ctx->addrs, addr)) {
+        ERR_MSG("unable to index address, out of memory");
+    }
+}
+
+/* Keep neighbor index and router table in line with neighbor cache. */
+static void
+neigh_cache_change(struct nl_cache *cache, struct nl_object *obj, int action, void *data)
+{
+    struct function_ctx *ctx = data;
+    struct rtnl_neigh *neigh = (struct rtnl_neigh *) obj;
+
+    ctx->dirty |= FCTX_DIRTY_NEIGH;
+    if (NL_ACT_DEL == action) {
+        neigh_index_remove(ctx->neighs, neigh);
+    } else if (neigh_index_add(ctx->neighs, neigh)) {
+        ERR_MSG("unable to index neighbor, out of memory");
+    }
+
+    router_table_neigh(ctx->routers, neigh, action);
+}
+
 struct function_ctx *
 make_function_ctx()
 {
-    /* struct nl_cache *link_cache, *addr_cache; */
     struct function_ctx *hctx;
     int rc = 0;
 
     hctx = calloc(1, sizeof(*hctx));
+    if (!hctx) {
+        return NULL;
+    }
+    pthread_mutex_init(&hctx->lock, NULL);
 
-
-    struct nl_sock *sk;
-    rc = socket_init(&sk, NETLINK_ROUTE);
+    rc = socket_init(&hctx->socket, NETLINK_ROUTE);
     if (rc) {
         ERR_MSG("socket not initialized");
         goto error;
     }
-    hctx->socket = sk;
 
-    rc = rtnl_link_alloc_cache(hctx->socket, AF_UNSPEC, &(hctx->cache_link));
-    if (rc) {
-        ERR("cache alloc error: %d", rc);
+    /* Cache manager connects and subscribes this socket itself. */
+    hctx->event_socket = nl_socket_alloc();
+    if (!hctx->event_socket) {
+        ERR_MSG("unable to allocate netlink event socket");
+        goto error;
+    }
+
+    rc = nl_cache_mngr_alloc(hctx->event_socket, NETLINK_ROUTE, NL_AUTO_PROVIDE, &hctx->mngr);
+    if (rc < 0) {
+        ERR("cache manager alloc error: %s", nl_geterror(rc));
+        goto error;
+    }
+
+    /* Notifications are drained lazily, leave room for bursts. */
+    nl_socket_set_buffer_size(hctx->event_socket, NL_EVENT_BUFSIZE, 0);
+
+    hctx->needle = rtnl_link_alloc();
+    if (!hctx->needle) {
+        ERR_MSG("unable to allocate link");
+        goto error;
+    }
+
+    rc = nl_cache_mngr_add(hctx->mngr, "route/link", link_cache_change, hctx, &hctx->cache_link);
+    if (rc < 0) {
+        ERR("cache alloc error: %s", nl_geterror(rc));
+        goto error;
+    }
+
+    hctx->addrs = addr_index_new();
+    if (!hctx->addrs) {
+        ERR_MSG("unable to allocate address index");
+        goto error;
+    }
+
+    rc = nl_cache_mngr_add(hctx->mngr, "route/addr", addr_cache_change, hctx, &hctx->cache_addr);
+    if (rc < 0) {
+        ERR("cant allocate addr cache: %s", nl_geterror(rc));
+        goto error;
+    }
+
+    /* Initial fill does not go through change callback. */
+    if (addr_index_rebuild(hctx->addrs, hctx->cache_addr)) {
+        ERR_MSG("unable to index addresses");
         goto error;
     }
 
-    rc = rtnl_addr_alloc_cache(hctx->socket, &(hctx->cache_addr));
-    if (rc != 0) {
-        ERR("cant allocate addr cache: %d", rc);
+    hctx->neighs = neigh_index_new();
+    if (!hctx->neighs) {
+        ERR_MSG("unable to allocate neighbor index");
         goto error;
     }
 
+    hctx->routers = router_table_new(hctx->socket);
+    if (!hctx->routers) {
+        ERR_MSG("unable to track routers");
+        goto error;
+    }
+
+    rc = nl_cache_mngr_add(hctx->mngr, "route/neigh", neigh_cache_change, hctx, &hctx->cache_neigh);
+    if (rc < 0) {
+        ERR("cant allocate neighbor cache: %s", nl_geterror(rc));
+        goto error;
+    }
+
+    if (neigh_index_rebuild(hctx->neighs, hctx->cache_neigh)) {
+        ERR_MSG("unable to index neighbors");
+        goto error;
+    }
+    router_table_rebuild_neigh(hctx->routers, hctx->cache_neigh);
+
     return hctx;
 
   error:
-    free(hctx);
+    free_function_ctx(hctx);
     return NULL;
 }
 
 void
 free_function_ctx(struct function_ctx *ctx)
 {
-    /* Maybe some libnl freeing before ctx ? */
+    if (!ctx) {
+        return;
+    }
+
+    /* Caches added to manager are freed with it. */
+    if (ctx->mngr) {
+        nl_cache_mngr_free(ctx->mngr);
+    }
+    if (ctx->event_socket) {
+        nl_socket_free(ctx->event_socket);
+    }
+    if (ctx->socket) {
+        nl_socket_free(ctx->socket);
+    }
+    if (ctx->needle) {
+        rtnl_link_put(ctx->needle);
+    }
+    addr_index_free(ctx->addrs);
+    neigh_index_free(ctx->neighs);
+    router_table_free(ctx->routers);
+    pthread_mutex_destroy(&ctx->lock);
     free(ctx);
 }
 
+int
+update_function_ctx(struct function_ctx *ctx)
+{
+    int router_rc;
+    int rc = 0;
+
+    router_rc = router_table_poll(ctx->routers, ctx->socket);
+    if (router_rc < 0) {
+        ERR("route notifications failed (%s)", nl_geterror(router_rc));
+    } else if (router_rc > 0) {
+        ctx->dirty |= FCTX_DIRTY_NEIGH;
+    }
+
+    /* Cache manager is drained even if routes failed, or its descriptor
+     * stays readable and wakes monitor again right away. */
+    rc = nl_cache_mngr_poll(ctx->mngr, 0);
+    if (rc >= 0) {
+        return router_rc < 0 ? router_rc : 0;
+    }
+
+    /* Socket buffer overrun, some notifications are lost. */
+    WRN("netlink notifications lost (%s), resyncing caches", nl_geterror(rc));
+    ctx->dirty |= FCTX_DIRTY_LINK | FCTX_DIRTY_NEIGH;
+
+    rc = nl_cache_refill(ctx->socket, ctx->cache_link);
+    if (rc < 0) {
+        return rc;
+    }
+
+    rc = nl_cache_refill(ctx->socket, ctx->cache_addr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (addr_index_rebuild(ctx->addrs, ctx->cache_addr)) {
+        return -NLE_NOMEM;
+    }
+
+    rc = nl_cache_refill(ctx->socket, ctx->cache_neigh);
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (neigh_index_rebuild(ctx->neighs, ctx->cache_neigh)) {
+        return -NLE_NOMEM;
+    }
+    router_table_rebuild_neigh(ctx->routers, ctx->cache_neigh);
+
+    return 1;
+}
+
+size_t
+get_event_fds(struct function_ctx *ctx, int *fds, size_t size)
+{
+    size_t count = 0;
+
+    if (count < size) {
+        fds[count++] = nl_cache_mngr_get_fd(ctx->mngr);
+    }
+    if (count < size) {
+        fds[count++] = nl_socket_get_fd(ctx->routers->socket);
+    }
+
+    return count;
+}
+
 void
-init_prefixlen_cb(struct nl_object *nlobj, void *data)
+set_link_change_cb(struct function_ctx *ctx, link_change_cb cb, void *arg)
 {
-    uint8_t *res = data;
-    uint8_t prefixlen = (uint8_t) rtnl_addr_get_prefixlen((struct rtnl_addr *) nlobj);
-    *res = prefixlen;
+    ctx->link_change = cb;
+    ctx->link_change_arg = arg;
 }
 
+struct rtnl_link *
+get_link(struct function_ctx *ctx, int ifindex)
+{
+    /* Link objects are hashed by ifindex and family. */
+    rtnl_link_set_ifindex(ctx->needle, ifindex);
+    rtnl_link_set_family(ctx->needle, AF_UNSPEC);
 
-uint8_t
-init_prefixlen(struct function_ctx *ctx)
+    return (struct rtnl_link *) nl_cache_search(ctx->cache_link, OBJ_CAST(ctx->needle));
+}
+
+/* Format address and prefix length of an address cache object. */
+static int
+addr_format(struct rtnl_addr *addr, struct if_address *out)
 {
-    uint8_t prefixlen;
-    nl_cache_foreach(ctx->cache_addr, init_prefixlen_cb, (void*) &prefixlen);
-    return prefixlen;
+    struct nl_addr *local = rtnl_addr_get_local(addr);
+
+    if (!local || !inet_ntop(nl_addr_get_family(local), nl_addr_get_binary_addr(local),
+                             out->ip, sizeof(out->ip))) {
+        return -1;
+    }
+    out->prefix_length = (uint8_t) rtnl_addr_get_prefixlen(addr);
+    out->flags = rtnl_addr_get_flags(addr);
+    out->scope = rtnl_addr_get_scope(addr);
+
+    return 0;
 }
 
-void
-get_ip4_cb(struct nl_object *nlobj, void *data)
+size_t
+get_addresses(struct function_ctx *ctx, int ifindex, int family,
+              struct if_address *addrs, size_t size)
 {
-    struct {
-        int ifindex;
-        char result_addr[80];
-    } *msg = data;
+    addr_family idx_family = addr_index_family(family);
+    struct addr_entry *entry;
+    struct if_addrs *ifa;
+    size_t count = 0;
 
-    int ifindex = msg->ifindex;
-    struct rtnl_addr *addr = (struct rtnl_addr *) nlobj;
-    int ifindex_cur;
-    int family;
-    struct nl_addr *addr_local;
+    if (ADDR_FAMILY_COUNT == idx_family) {
+        return 0;
+    }
 
-    ifindex_cur = rtnl_addr_get_ifindex(addr);
-    if (ifindex != ifindex_cur) {
-        return;
+    ifa = addr_index_find(ctx->addrs, ifindex);
+    if (!ifa) {
+        return 0;
     }
 
-    family = rtnl_addr_get_family(addr);
-    if (AF_INET6 == family) {
-        return;
+    addr_index_for_each(entry, ifa, idx_family) {
+        if (count < size && addr_format(entry->addr, &addrs[count])) {
+            continue;
+        }
+        count++;
     }
 
-    addr_local = rtnl_addr_get_local(addr);
-    nl_addr2str(addr_local, msg->result_addr, sizeof(msg->result_addr));
+    return count;
 }
 
-char *
-get_ip4(struct function_ctx *ctx, struct rtnl_link *link)
+struct if_address *
+get_addresses_alloc(struct function_ctx *ctx, int ifindex, int family, size_t *count)
+{
+    struct if_address *addrs;
+    size_t size;
+
+    *count = 0;
+
+    size = get_addresses(ctx, ifindex, family, NULL, 0);
+    if (!size) {
+        return NULL;
+    }
+
+    addrs = calloc(size, sizeof(*addrs));
+    if (!addrs) {
+        return NULL;
+    }
+
+    /* Index does not change in between, caller holds ctx lock. */
+    *count = get_addresses(ctx, ifindex, family, addrs, size);
+    if (*count > size) {
+        *count = size;
+    }
+
+    return addrs;
+}
+
+/* Format neighbor cache object, failed and unused entries are skipped. */
+static int
+neigh_format(struct function_ctx *ctx, struct rtnl_neigh *neigh, struct if_neighbor *out)
+{
+    struct nl_addr *dst = rtnl_neigh_get_dst(neigh);
+    struct nl_addr *lladdr = rtnl_neigh_get_lladdr(neigh);
+    int state = rtnl_neigh_get_state(neigh);
+
+    if (state < 0 || NUD_NONE == state || state & NUD_FAILED) {
+        return -1;
+    }
+    if (!inet_ntop(nl_addr_get_family(dst), nl_addr_get_binary_addr(dst), out->ip, sizeof(out->ip))) {
+        return -1;
+    }
+
+    out->lladdr[0] = '\0';
+    if (lladdr && nl_addr_get_len(lladdr)) {
+        nl_addr2str(lladdr, out->lladdr, sizeof(out->lladdr));
+    }
+    out->state = (uint16_t) state;
+    out->router = AF_INET6 == nl_addr_get_family(dst) &&
+                  router_table_is_router(ctx->routers, rtnl_neigh_get_ifindex(neigh),
+                                         nl_addr_get_binary_addr(dst));
+
+    return 0;
+}
+
+struct if_neighbor *
+get_neighbors_alloc(struct function_ctx *ctx, int ifindex, int family, size_t *count)
 {
-    struct nl_cache *addr_cache;
+    addr_family index_family = addr_index_family(family);
+    struct if_neighbor *neighs;
+    struct in6_addr *routers = NULL;
+    struct neigh_entry *entry;
+    struct if_neighs *ifn;
+    size_t routers_cnt = 0;
+    size_t size = 0;
+
+    *count = 0;
+
+    if (ADDR_FAMILY_COUNT == index_family) {
+        return NULL;
+    }
 
-    int ifindex = rtnl_link_get_ifindex(link);
+    ifn = neigh_index_find_if(ctx->neighs, ifindex);
+    if (ifn) {
+        size = ifn->count[index_family];
+    }
+    if (AF_INET6 == family) {
+        routers = router_table_get(ctx->routers, ifindex, &routers_cnt);
+        size += routers_cnt;
+    }
+    if (!size) {
+        return NULL;
+    }
 
-    struct {
-        int ifindex;
-        char result_addr[80];
-    } *msg;
+    neighs = calloc(size, sizeof(*neighs));
+    if (!neighs) {
+        free(routers);
+        return NULL;
+    }
 
-    rtnl_addr_alloc_cache(ctx->socket, &addr_cache);
-    msg = calloc(1, sizeof(*msg));
-    msg->ifindex = ifindex;
+    if (ifn) {
+        neigh_index_for_each(entry, ifn, index_family) {
+            if (0 == neigh_format(ctx, entry->neigh, &neighs[*count])) {
+                (*count)++;
+            }
+        }
+    }
 
-    nl_cache_foreach(ctx->cache_addr, get_ip4_cb, (void*)msg);
+    /* Routers known only from RA, others came with their neighbor entry. */
+    for (size_t i = 0; i < routers_cnt; i++) {
+        if (neigh_index_find(ctx->neighs, ifindex, AF_INET6, &routers[i], sizeof(routers[i])) ||
+            !inet_ntop(AF_INET6, &routers[i], neighs[*count].ip, sizeof(neighs[*count].ip))) {
+            continue;
+        }
+        neighs[(*count)++].router = true;
+    }
 
-    char *res = strdup(msg->result_addr);
+    free(routers);
 
-    free(msg);
+    return neighs;
+}
 
-    return res;
+int
+get_ip4(struct function_ctx *ctx, int ifindex, struct if_address *addr)
+{
+    return get_addresses(ctx, ifindex, AF_INET, addr, 1) ? 0 : -1;
 }
 
 
@@ -210,29 +511,91 @@ get_ip4(struct function_ctx *ctx, struct rtnl_link *link)
 /*     return rc; */
 /* } */
 
-/* Set UCI configuration item. */
+int
+uci_batch_begin(struct uci_batch *batch, struct uci_context *uctx)
+{
+    int rc = UCI_OK;
+
+    batch->uctx = uctx;
+    batch->package = NULL;
+    batch->staged = 0;
+
+    rc = uci_load(uctx, UCI_NETWORK_PACKAGE, &batch->package);
+    UCI_CHECK_RET(rc, error, "uci_load %d %s", rc, UCI_NETWORK_PACKAGE);
+
+  error:
+    return rc;
+}
+
+int
+uci_batch_commit(struct uci_batch *batch)
+{
+    int rc = UCI_OK;
+
+    if (!batch->package) {
+        return UCI_ERR_INVAL;
+    }
+
+    if (batch->staged) {
+        /* Package file is rewritten once for all staged options. */
+        rc = uci_commit(batch->uctx, &batch->package, false);
+        UCI_CHECK_RET(rc, exit, "uci_commit %d, %zu options lost", rc, batch->staged);
+        INF("UCI committed %zu options.", batch->staged);
+    }
+
+  exit:
+    uci_batch_abort(batch);
+    return rc;
+}
+
+void
+uci_batch_abort(struct uci_batch *batch)
+{
+    if (batch->package) {
+        uci_unload(batch->uctx, batch->package);
+        batch->package = NULL;
+    }
+    batch->staged = 0;
+}
+
+/* Stage UCI configuration item, option is deleted if option_val is NULL. */
 static int
-set_uci_item(struct uci_context *uctx, char *section_type,
-             char *option_name, char *option_val)
+set_uci_item(struct uci_batch *batch, const char *section_type,
+             const char *option_name, const char *option_val)
 {
     int rc = UCI_OK;
-    char path[MAX_UCI_PATH];
-    struct uci_ptr ptr;
-    char *path_fmt = "network.%s.%s=%s"; /* section-type.option-name=value */
+    /* Pointer is filled directly, no path is formatted and parsed. */
+    struct uci_ptr ptr = {
+        .package = UCI_NETWORK_PACKAGE,
+        .section = section_type,
+        .option = option_name,
+        .value = option_val,
+    };
 
-    sprintf(path, path_fmt, section_type, option_name, option_val);
+    if (!batch->package) {
+        return UCI_ERR_INVAL;
+    }
 
-    rc = uci_lookup_ptr(uctx, &ptr, path, true);
-    UCI_CHECK_RET(rc, error, "lookup_pointer %d %s", rc, path);
+    rc = uci_lookup_ptr(batch->uctx, &ptr, NULL, false);
+    UCI_CHECK_RET(rc, error, "lookup_pointer %d %s.%s", rc, section_type, option_name);
 
-    rc = uci_set(uctx, &ptr);
-    UCI_CHECK_RET(rc, error, "uci_set %d %s", rc, path);
+    if (!ptr.s) {
+        ERR("UCI section %s not found", section_type);
+        return UCI_ERR_NOTFOUND;
+    }
 
-    rc = uci_save(uctx, ptr.p);
-    UCI_CHECK_RET(rc, error, "uci_save %d %s", rc, path);
+    if (option_val) {
+        rc = uci_set(batch->uctx, &ptr);
+        UCI_CHECK_RET(rc, error, "uci_set %d %s.%s", rc, section_type, option_name);
+    } else if (ptr.o) {
+        rc = uci_delete(batch->uctx, &ptr);
+        UCI_CHECK_RET(rc, error, "uci_delete %d %s.%s", rc, section_type, option_name);
+    } else {
+        /* Nothing to delete. */
+        return UCI_OK;
+    }
 
-    rc = uci_commit(uctx, &(ptr.p), false);
-    UCI_CHECK_RET(rc, error, "uci_commit %d %s", rc, path);
+    batch->staged++;
 
     return UCI_OK;
 
@@ -249,21 +612,23 @@ get_uci_item(struct uci_context *uctx, char *interface_type, char *option_name)
     int rc = UCI_OK;
     char path[MAX_UCI_PATH];
     struct uci_ptr ptr;
+    int len;
+
+    len = snprintf(path, sizeof(path), UCI_NETWORK_PACKAGE ".%s.%s", interface_type, option_name);
+    if (len < 0 || (size_t) len >= sizeof(path)) {
+        ERR("UCI path too long for %s.%s", interface_type, option_name);
+        return NULL;
+    }
 
-    sprintf(path, "network.%s.%s", interface_type, option_name);
     rc = uci_lookup_ptr(uctx, &ptr, path, true);
 
-    return rc == UCI_OK ? strdup(ptr.o->v.string) : NULL;
+    return (rc == UCI_OK && ptr.o) ? strdup(ptr.o->v.string) : NULL;
 }
 
 int
-set_forwarding(struct uci_context *uctx, char *interface_type, bool forwarding)
+set_forwarding(struct uci_batch *batch, char *interface_type, bool forwarding)
 {
-    int length = snprintf(NULL, 0, "%uh", forwarding);
-    char *forwarding_str = calloc(1, length);
-    snprintf(forwarding_str, length, "%uh", forwarding);
-
-    return set_uci_item(uctx, interface_type, "forwarding", forwarding_str);
+    return set_uci_item(batch, interface_type, "forwarding", forwarding ? "1" : "0");
 }
 
 char *
@@ -273,9 +638,144 @@ get_forwarding(struct uci_context *uctx, char *interface_type)
 }
 
 int
-set_ip4(struct uci_context *uctx, char *network_type, char *ip)
+set_ip4(struct uci_batch *batch, char *network_type, char *ip)
+{
+    return set_uci_item(batch, network_type, "ipaddr", (ip && ip[0]) ? ip : NULL);
+}
+
+/* Stage adding or removing one value of UCI list. */
+static int
+set_uci_list_item(struct uci_batch *batch, const char *section_type,
+                  const char *option_name, const char *option_val, bool add)
+{
+    int rc = UCI_OK;
+    struct uci_ptr ptr = {
+        .package = UCI_NETWORK_PACKAGE,
+        .section = section_type,
+        .option = option_name,
+        .value = option_val,
+    };
+
+    rc = uci_lookup_ptr(batch->uctx, &ptr, NULL, false);
+    UCI_CHECK_RET(rc, error, "lookup_pointer %d %s.%s", rc, section_type, option_name);
+
+    if (!ptr.s) {
+        ERR("UCI section %s not found", section_type);
+        return UCI_ERR_NOTFOUND;
+    }
+
+    rc = add ? uci_add_list(batch->uctx, &ptr) : uci_del_list(batch->uctx, &ptr);
+    UCI_CHECK_RET(rc, error, "uci list %d %s.%s", rc, section_type, option_name);
+
+    batch->staged++;
+
+  error:
+    return rc;
+}
+
+/* Stage address list option, only delta is staged if option is a list.
+ * Option holding single value is replaced by list of all addresses,
+ * returns 1 in that case. */
+static int
+set_address_list(struct uci_batch *batch, char *network_type, const char *option,
+                 const struct address_list *addresses, const struct address_list *added,
+                 const struct address_list *removed)
+{
+    int rc = UCI_OK;
+    int converted = 0;
+    char cidr[ADDRESS_CIDR_LEN];
+    const struct ip_address *address;
+    struct uci_ptr ptr = {
+        .package = UCI_NETWORK_PACKAGE,
+        .section = network_type,
+        .option = option,
+    };
+
+    if (!batch->package) {
+        return UCI_ERR_INVAL;
+    }
+
+    rc = uci_lookup_ptr(batch->uctx, &ptr, NULL, false);
+    UCI_CHECK_RET(rc, error, "lookup_pointer %d %s.%s", rc, network_type, option);
+
+    if (ptr.o && UCI_TYPE_STRING == ptr.o->type) {
+        set_uci_item(batch, network_type, option, NULL);
+        added = addresses;
+        converted = 1;
+    } else {
+        address_list_for_each(address, removed) {
+            address_to_cidr(address, cidr, sizeof(cidr));
+            set_uci_list_item(batch, network_type, option, cidr, false);
+        }
+    }
+
+    address_list_for_each(address, added) {
+        address_to_cidr(address, cidr, sizeof(cidr));
+        rc = set_uci_list_item(batch, network_type, option, cidr, true);
+        if (UCI_OK != rc) {
+            goto error;
+        }
+    }
+
+    return converted;
+
+  error:
+    return rc;
+}
+
+int
+set_ip4_addresses(struct uci_batch *batch, char *network_type, const struct address_list *addresses,
+                  const struct address_list *added, const struct address_list *removed)
+{
+    int rc = set_address_list(batch, network_type, "ipaddr", addresses, added, removed);
+
+    if (1 == rc) {
+        /* Prefix length is part of list entries. */
+        set_uci_item(batch, network_type, "netmask", NULL);
+        set_uci_item(batch, network_type, "ip4prefixlen", NULL);
+        rc = UCI_OK;
+    }
+
+    return rc;
+}
+
+int
+set_ip6_addresses(struct uci_batch *batch, char *network_type, const struct address_list *addresses,
+                  const struct address_list *added, const struct address_list *removed)
+{
+    int rc = set_address_list(batch, network_type, "ip6addr", addresses, added, removed);
+
+    return 1 == rc ? UCI_OK : rc;
+}
+
+int
+set_ipv6_enabled(struct uci_batch *batch, char *network_type, bool enabled)
+{
+    return set_uci_item(batch, network_type, "ipv6", enabled ? "1" : "0");
+}
+
+int
+set_mtu6(struct uci_batch *batch, char *network_type, uint32_t mtu)
+{
+    char mtu_str[UCI_NUM_LEN];
+
+    if (0 == mtu) {
+        return set_uci_item(batch, network_type, "mtu6", NULL);
+    }
+
+    snprintf(mtu_str, sizeof(mtu_str), "%u", mtu);
+
+    return set_uci_item(batch, network_type, "mtu6", mtu_str);
+}
+
+int
+set_dad_transmits(struct uci_batch *batch, char *network_type, uint32_t transmits)
 {
-    return set_uci_item(uctx, network_type, "ipaddr", ip);
+    char num_str[UCI_NUM_LEN];
+
+    snprintf(num_str, sizeof(num_str), "%u", transmits);
+
+    return set_uci_item(batch, network_type, "dadtransmits", num_str);
 }
 
 /* init prefixlen */
@@ -286,33 +786,39 @@ get_prefixlen(struct uci_context *uctx, char *interface_type)
 }
 
 int
-set_prefixlen(struct uci_context *uctx, char *interface_type, uint8_t prefixlen)
+set_prefixlen(struct uci_batch *batch, char *interface_type, uint8_t prefixlen)
 {
-    int length = snprintf(NULL, 0, "%uh", prefixlen);
-    char *prefixlen_str = calloc(1, length);
-    snprintf(prefixlen_str, length, "%uh", prefixlen);
+    char prefixlen_str[UCI_NUM_LEN];
+
+    snprintf(prefixlen_str, sizeof(prefixlen_str), "%u", prefixlen);
 
-    return set_uci_item(uctx, interface_type, "ip4prefixlen", prefixlen_str);
+    return set_uci_item(batch, interface_type, "ip4prefixlen", prefixlen_str);
 }
 
 int
-set_netmask(struct uci_context *uctx, char *network_type, char *netmask)
+set_netmask(struct uci_batch *batch, char *network_type, char *netmask)
 {
-    return set_uci_item(uctx, network_type, "netmask", netmask);
+    return set_uci_item(batch, network_type, "netmask", netmask);
 }
 
 
 char *
-get_mac(struct rtnl_link *link)
+get_mac_buf(struct rtnl_link *link, char *buf, size_t size)
 {
-    char buf[SIZE_BUF];
     struct nl_addr *addr = rtnl_link_get_addr(link);
-    if (!addr) {
-        ERR_MSG("addr error");
+    if (!addr || nl_addr_iszero(addr)) {
+        return NULL;
     }
 
-    nl_addr2str(addr, buf, sizeof(buf));
-    return strdup(buf);
+    return nl_addr2str(addr, buf, size);
+}
+
+char *
+get_mac(struct rtnl_link *link)
+{
+    char buf[SIZE_BUF];
+
+    return get_mac_buf(link, buf, sizeof(buf)) ? strdup(buf) : NULL;
 }
 
 int
@@ -342,28 +848,13 @@ print_tc_info(struct tc_info_entry *tc_info, uint32_t count)
 }
 
 void
-get_tc_info(struct rtnl_link *link)
-{
-    int count;
-    uint64_t stat;
-    char buf[SIZE_BUF] = { 0 };
-    struct tc_info_entry entries[] =  {
-        { "rx_packets", 0 },
-        { "rx_bytes",   0 },
-        { "rx_errors",  0 },
-        { "tx_packets", 0 },
-        { "tx_bytes",   0 },
-        { "tx_errors",  0 },
-    };
-
-    count = sizeof(entries) / sizeof(entries[0]);
-    /* int family = rtnl_link_get_family(link); */
-    /* struct nl_addr *addr = rtnl_link_get_addr(link); */
+get_tc_info(struct rtnl_link *link, struct tc_info_entry *tc_info, uint32_t count)
+{
+    int id;
 
-    for (int i = 0; i < RTNL_LINK_STATS_MAX; i++) {
-        stat = rtnl_link_get_stat(link, i);
-        rtnl_link_stat2str(i, buf, sizeof(buf));
-        parse_tc_info(buf, stat, entries, count);
+    for (uint32_t i = 0; i < count; i++) {
+        id = rtnl_link_str2stat(tc_info[i].name);
+        tc_info[i].val = id < 0 ? 0 : rtnl_link_get_stat(link, id);
     }
 }
 
@@ -381,34 +872,31 @@ init_mtu(struct rtnl_link *link, uint16_t mtu)
     return 0;
 }
 
-uint16_t
+unsigned int
 get_mtu(struct rtnl_link *link)
 {
-    unsigned int mtu = rtnl_link_get_mtu(link);
-
-    return mtu;
+    return rtnl_link_get_mtu(link);
 }
 
 int
-set_name(struct uci_context *uctx, char *network_type, uint16_t mtu)
+set_name(struct uci_batch *batch, char *network_type, char *ifname)
 {
-    int length = snprintf(NULL, 0, "%uh", mtu);
-    char *mtu_str = calloc(1, length);
-    snprintf(mtu_str, length, "%uh", mtu);
-
-    return set_uci_item(uctx, network_type, "ifname", mtu_str);
+    return set_uci_item(batch, network_type, "ifname", ifname);
 }
 
 int
-set_mtu(struct uci_context *uctx, char *network_type, uint16_t mtu)
+set_mtu(struct uci_batch *batch, char *network_type, uint16_t mtu)
 {
-    int length = snprintf(NULL, 0, "%uh", mtu);
-    char *mtu_str = calloc(1, length);
-    snprintf(mtu_str, length, "%uh", mtu);
+    char mtu_str[UCI_NUM_LEN];
+
+    if (0 == mtu) {
+        /* MTU not configured, kernel default is used. */
+        return set_uci_item(batch, network_type, "mtu", NULL);
+    }
 
-    printf("set_mtu %s %u\n", network_type, mtu);
+    snprintf(mtu_str, sizeof(mtu_str), "%u", mtu);
 
-    return set_uci_item(uctx, network_type, "mtu", mtu_str);
+    return set_uci_item(batch, network_type, "mtu", mtu_str);
 }
 
 uint32_t
@@ -428,31 +916,143 @@ init_forwarding(struct rtnl_link *link)
 /*     rtnl_link_set_operstate(link, operstate); */
 /* } */
 int
-set_operstate(struct uci_context *uctx, char *network_type, uint16_t operstate)
+set_operstate(struct uci_batch *batch, char *network_type, uint16_t operstate)
 {
-    return set_uci_item(uctx, network_type, "enabled", operstate ? "1" : "0");
+    return set_uci_item(batch, network_type, "enabled", operstate ? "1" : "0");
 }
 
 
-char *
+const char *
 get_operstate(struct rtnl_link *link)
 {
-    uint8_t operstate_code;
-    char buf[64] = { 0 };
+    switch (rtnl_link_get_operstate(link)) {
+    case IF_OPER_UP: return "up";
+    case IF_OPER_DOWN: return "down";
+    case IF_OPER_TESTING: return "testing";
+    case IF_OPER_DORMANT: return "dormant";
+    case IF_OPER_NOTPRESENT: return "not-present";
+    case IF_OPER_LOWERLAYERDOWN: return "lower-layer-down";
+    case IF_OPER_UNKNOWN:
+    default:
+        /* Drivers without carrier detection (e.g. loopback) never leave
+         * IF_OPER_UNKNOWN, use administrative and carrier flags instead. */
+        return (rtnl_link_get_flags(link) & IFF_RUNNING) ? "up" : "unknown";
+    }
+}
+
+const char *
+get_if_type(struct rtnl_link *link)
+{
+    char *kind = rtnl_link_get_type(link);
+
+    if (kind && !strcmp(kind, "vlan")) {
+        return "iana-if-type:l2vlan";
+    }
+    if (kind && !strcmp(kind, "bridge")) {
+        return "iana-if-type:bridge";
+    }
+
+    switch (rtnl_link_get_arptype(link)) {
+    case ARPHRD_ETHER: return "iana-if-type:ethernetCsmacd";
+    case ARPHRD_LOOPBACK: return "iana-if-type:softwareLoopback";
+    case ARPHRD_PPP: return "iana-if-type:ppp";
+    case ARPHRD_IEEE80211: return "iana-if-type:ieee80211";
+    case ARPHRD_TUNNEL:
+    case ARPHRD_TUNNEL6:
+    case ARPHRD_SIT:
+    case ARPHRD_IPGRE: return "iana-if-type:tunnel";
+    default: return "iana-if-type:other";
+    }
+}
+
+int
+get_speed(const char *ifname, uint64_t *speed)
+{
+    char path[SIZE_BUF + IFNAMSIZ];
+    long long mbps = -1;
+    FILE *fp;
 
-    int flag = rtnl_link_get_flags(link);
-    rtnl_link_flags2str(flag, buf, sizeof(buf));
+    snprintf(path, sizeof(path), SYSFS_NET_PATH "/%s/speed", ifname);
 
-    operstate_code = rtnl_link_get_operstate(link);
-    rtnl_link_operstate2str(operstate_code, buf, sizeof(buf));
+    /* Reading speed fails with EINVAL for interfaces without a link. */
+    fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    if (fscanf(fp, "%lld", &mbps) != 1) {
+        mbps = -1;
+    }
+    fclose(fp);
+
+    if (mbps <= 0) {
+        return -1;
+    }
+
+    *speed = (uint64_t) mbps * 1000000;
+
+    return 0;
+}
+
+int
+get_inet6_conf(const char *ifname, const char *option, uint32_t *value)
+{
+    char path[SIZE_BUF + IFNAMSIZ];
+    long long val = -1;
+    FILE *fp;
+
+    snprintf(path, sizeof(path), PROC_IPV6_CONF_PATH "/%s/%s", ifname, option);
+
+    /* Directory is missing if IPv6 is not available on interface. */
+    fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    if (fscanf(fp, "%lld", &val) != 1) {
+        val = -1;
+    }
+    fclose(fp);
+
+    if (val < 0) {
+        return -1;
+    }
+
+    *value = (uint32_t) val;
+
+    return 0;
+}
+
+int
+set_inet6_conf(const char *ifname, const char *option, uint32_t value)
+{
+    char path[SIZE_BUF + IFNAMSIZ];
+    FILE *fp;
+    int rc = 0;
 
-    return strdup(buf);
+    snprintf(path, sizeof(path), PROC_IPV6_CONF_PATH "/%s/%s", ifname, option);
+
+    fp = fopen(path, "w");
+    if (!fp) {
+        ERR("Can't open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (fprintf(fp, "%u\n", value) < 0) {
+        rc = -1;
+    }
+    /* Kernel rejects invalid value when buffer is flushed. */
+    if (fclose(fp)) {
+        rc = -1;
+    }
+    if (rc) {
+        ERR("Can't write %u to %s: %s", value, path, strerror(errno));
+    }
+
+    return rc;
 }
 
 int
-set_origin(struct uci_context *uctx, char *network_type, char *origin)
+set_origin(struct uci_batch *batch, char *network_type, char *origin)
 {
-    return set_uci_item(uctx, network_type, "origin", origin);
+    return set_uci_item(batch, network_type, "origin", origin);
 }
 
 /* Callback used for applying changes to cache. */
@@ -534,7 +1134,8 @@ functions_init()
 /*     struct rtnl_link *link = rtnl_link_get_by_name(link_cache, "enp3s0"); */
 /*     int ifindex = rtnl_link_get_ifindex(link); */
 
-/*     const char *ip = get_ip4(ctx, link); */
+/*     struct if_address ip; */
+/*     get_ip4(ctx, ifindex, &ip); */
 /*     free(ctx); */
 
 /* } */
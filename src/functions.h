@@ -1,5 +1,9 @@
+#ifndef __FUNCTIONS_H__
+#define __FUNCTIONS_H__
+
 #include <inttypes.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/types.h>
 
 #include <libnl3/netlink/netlink.h>
@@ -16,23 +20,69 @@
 #include <linux/nl80211.h>
 
 #include <uci.h>
+#include <arpa/inet.h>
+
+#include "address.h"
 
 #define SIZE_BUF 64
-#define MAX_UCI_PATH 64
+#define MAX_UCI_PATH 256
+#define UCI_NUM_LEN 12              /* decimal uint32 and terminator */
+#define UCI_NETWORK_PACKAGE "network"
 #define MAX_MTU 1500
 #define MIN_MTU 46
 
+#define SYSFS_NET_PATH "/sys/class/net"
+#define PROC_IPV6_CONF_PATH "/proc/sys/net/ipv6/conf"
+
 struct tc_info_entry {
     char *name;
     uint64_t val;
 };
 
 #define ADDR_STR_BUF_SIZE 80
+#define NL_EVENT_BUFSIZE (1024 * 1024)
+
+/* What changed since function_ctx dirty flags were last cleared. */
+#define FCTX_DIRTY_LINK (1 << 0)        /* links or addresses */
+#define FCTX_DIRTY_NEIGH (1 << 1)       /* neighbors or routers */
+
+struct addr_index;
+struct router_table;
+struct neigh_index;
+
+/**
+ * Called for every link added, changed (renamed) or removed while
+ * notifications are applied. Action is one of NL_ACT_NEW, NL_ACT_CHANGE
+ * or NL_ACT_DEL.
+ */
+typedef void (*link_change_cb)(struct rtnl_link *link, int action, void *arg);
 
+/**
+ * Plugin wide netlink context.
+ *
+ * Link, address and neighbor caches are owned by cache manager and kept
+ * up to date by RTNLGRP_LINK, RTNLGRP_IPV4_IFADDR, RTNLGRP_IPV6_IFADDR and
+ * RTNLGRP_NEIGH notifications, so lookups in them never need a kernel dump.
+ * Address index follows address cache, so addresses of one interface are
+ * found without walking the whole cache, neighbor index does the same
+ * for neighbor cache. Router table follows neighbor cache and RA default
+ * routes.
+ */
 struct function_ctx {
-  struct nl_sock *socket;
+  pthread_mutex_t lock;           /* serializes use of sockets and caches */
+  struct nl_sock *socket;         /* requests to kernel */
+  struct nl_sock *event_socket;   /* multicast notifications for cache manager */
+  struct nl_cache_mngr *mngr;
   struct nl_cache *cache_addr;
   struct nl_cache *cache_link;
+  struct nl_cache *cache_neigh;
+  struct rtnl_link *needle;       /* lookup key for cache_link hash table */
+  struct addr_index *addrs;       /* cache_addr indexed by ifindex and family */
+  struct neigh_index *neighs;     /* cache_neigh indexed by ifindex and family */
+  struct router_table *routers;   /* IPv6 routers on each link */
+  link_change_cb link_change;
+  void *link_change_arg;
+  unsigned int dirty;             /* FCTX_DIRTY_*, cleared by user */
 };
 
 enum {
@@ -44,47 +94,243 @@ struct function_ctx *make_function_ctx();
 
 void free_function_ctx(struct function_ctx *);
 
+/**
+ * @brief Apply pending netlink notifications to caches.
+ *
+ * Does not block. If notifications were lost, caches are refilled and
+ * link_change is not called for the lost changes. Dirty flags are set
+ * for whatever was changed.
+ *
+ * @return 0 on success, 1 if caches were refilled, negative libnl error otherwise.
+ */
+int update_function_ctx(struct function_ctx *ctx);
+
+/**
+ * @brief Get descriptors that become readable when notifications are
+ * pending for update_function_ctx.
+ *
+ * @return Number of descriptors stored, at most size.
+ */
+size_t get_event_fds(struct function_ctx *ctx, int *fds, size_t size);
+
+/**
+ * @brief Set callback for link changes applied by update_function_ctx.
+ */
+void set_link_change_cb(struct function_ctx *ctx, link_change_cb cb, void *arg);
+
+/**
+ * @brief Get link with given index from link cache.
+ *
+ * Lookup goes through cache hash table instead of walking the cache.
+ *
+ * @return Link with reference held (release with rtnl_link_put) or NULL.
+ */
+struct rtnl_link *get_link(struct function_ctx *ctx, int ifindex);
+
+/**
+ * Option changes staged against one loaded UCI network package.
+ *
+ * All set_* functions taking a batch only modify package in memory,
+ * uci_batch_commit writes configuration file once.
+ */
+struct uci_batch {
+    struct uci_context *uctx;
+    struct uci_package *package;
+    size_t staged;                  /* options set or deleted */
+};
+
+/**
+ * @brief Load network package for staging changes.
+ *
+ * @return UCI_OK on success, UCI error code otherwise.
+ */
+int uci_batch_begin(struct uci_batch *batch, struct uci_context *uctx);
+
+/**
+ * @brief Commit staged changes (if any) and release package.
+ *
+ * @return UCI_OK on success, UCI error code otherwise.
+ */
+int uci_batch_commit(struct uci_batch *batch);
+
+/**
+ * @brief Drop staged changes and release package.
+ */
+void uci_batch_abort(struct uci_batch *batch);
+
 /* init mac */
+/**
+ * @brief Get hardware address of an link.
+ *
+ * @return Newly allocated string or NULL if link has no hardware address.
+ */
 char *get_mac(struct rtnl_link *link);
+/**
+ * @brief Format hardware address of an link into caller's buffer.
+ *
+ * @return Buffer or NULL if link has no hardware address.
+ */
+char *get_mac_buf(struct rtnl_link *link, char *buf, size_t size);
 /* int set_mac() */
 
 uint32_t init_forwarding(struct rtnl_link *link);
 char *get_forwarding(struct uci_context *uctx, char *interface_type);
-int set_forwarding(struct uci_context *uctx, char *interface_type, bool forwarding);
+int set_forwarding(struct uci_batch *batch, char *interface_type, bool forwarding);
 
 int init_mtu(struct rtnl_link *link, uint16_t mtu);
 /**
  * @brief Get MTU for an interface.
  *
  * @param[in] link Link is assumed to by initialized by something like rtnl_link_get_by_name.
+ * @return MTU as reported by kernel, may exceed UINT16_MAX (e.g. loopback).
  */
-uint16_t get_mtu(struct rtnl_link *link);
-int set_mtu(struct uci_context *uctx, char *ifname, uint16_t mtu);
+unsigned int get_mtu(struct rtnl_link *link);
+/**
+ * @brief Stage MTU of an interface, MTU of 0 removes the option.
+ */
+int set_mtu(struct uci_batch *batch, char *ifname, uint16_t mtu);
 
-char *get_ip4(struct function_ctx *ctx, struct rtnl_link *link);
-int set_ip4(struct uci_context *uctx, char *network_type, char *ip);
+/**
+ * Address assigned to an interface.
+ */
+struct if_address {
+    char ip[INET6_ADDRSTRLEN];
+    uint8_t prefix_length;
+    uint32_t flags;                 /* IFA_F_* */
+    int scope;                      /* RT_SCOPE_* */
+};
+
+/**
+ * @brief Get addresses of given family assigned to an interface.
+ *
+ * Addresses are taken from address index, lookup costs O(addresses on interface).
+ *
+ * @param[in] family AF_INET or AF_INET6.
+ * @param[out] addrs Array filled with up to size addresses, primary address first.
+ * @return Number of addresses on interface, may be larger than size.
+ */
+size_t get_addresses(struct function_ctx *ctx, int ifindex, int family,
+                     struct if_address *addrs, size_t size);
+
+/**
+ * @brief Get all addresses of given family assigned to an interface.
+ *
+ * @param[out] count Number of addresses returned.
+ * @return Newly allocated array or NULL if interface has no addresses
+ * (or on allocation failure).
+ */
+struct if_address *get_addresses_alloc(struct function_ctx *ctx, int ifindex, int family, size_t *count);
+
+/**
+ * Neighbor known to an interface.
+ */
+struct if_neighbor {
+    char ip[INET6_ADDRSTRLEN];
+    char lladdr[ADDR_STR_BUF_SIZE]; /* empty if not resolved */
+    uint16_t state;                 /* NUD_*, 0 if neighbor entry is missing */
+    bool router;
+};
+
+/**
+ * @brief Get all neighbors of given family of an interface.
+ *
+ * Neighbors are taken from neighbor index. IPv6 routers learned only
+ * from router advertisements are included even without neighbor entry.
+ * Failed entries are left out.
+ *
+ * @param[in] family AF_INET or AF_INET6.
+ * @param[out] count Number of neighbors returned.
+ * @return Newly allocated array or NULL if interface has no neighbors
+ * (or on allocation failure).
+ */
+struct if_neighbor *get_neighbors_alloc(struct function_ctx *ctx, int ifindex, int family, size_t *count);
+
+/**
+ * @brief Get primary IPv4 address of an interface.
+ *
+ * @return 0 on success, -1 if interface has no IPv4 address.
+ */
+int get_ip4(struct function_ctx *ctx, int ifindex, struct if_address *addr);
+int set_ip4(struct uci_batch *batch, char *network_type, char *ip);
+/**
+ * @brief Stage IPv4 address list of an interface.
+ *
+ * Addresses are kept in ipaddr list in CIDR notation, only removed and
+ * added addresses are staged. Single address in legacy ipaddr option
+ * (with netmask or ip4prefixlen) is converted to list of all addresses.
+ */
+int set_ip4_addresses(struct uci_batch *batch, char *network_type, const struct address_list *addresses,
+                      const struct address_list *added, const struct address_list *removed);
+/**
+ * @brief Stage IPv6 address list (ip6addr) of an interface, see set_ip4_addresses.
+ */
+int set_ip6_addresses(struct uci_batch *batch, char *network_type, const struct address_list *addresses,
+                      const struct address_list *added, const struct address_list *removed);
+
+/**
+ * @brief Stage IPv6 options of an interface, MTU of 0 removes the option.
+ */
+int set_ipv6_enabled(struct uci_batch *batch, char *network_type, bool enabled);
+int set_mtu6(struct uci_batch *batch, char *network_type, uint32_t mtu);
+int set_dad_transmits(struct uci_batch *batch, char *network_type, uint32_t transmits);
+
+/**
+ * @brief Read per interface IPv6 sysctl (e.g. "forwarding", "mtu").
+ *
+ * Like link speed, these are not part of rtnetlink link message libnl parses.
+ *
+ * @return 0 on success, -1 if value can not be read (IPv6 not available).
+ */
+int get_inet6_conf(const char *ifname, const char *option, uint32_t *value);
+
+/**
+ * @brief Write per interface IPv6 sysctl.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int set_inet6_conf(const char *ifname, const char *option, uint32_t value);
 
-uint8_t init_prefixlen(struct function_ctx *ctx);
 char * get_prefixlen(struct uci_context *, char *);
-int set_prefixlen(struct uci_context *uctx, char *interface_type, uint8_t prefixlen);
+int set_prefixlen(struct uci_batch *batch, char *interface_type, uint8_t prefixlen);
 
 /* init netmask */
 uint8_t get_netmask(struct function_ctx *ctx);
-int set_netmask(struct uci_context *uctx, char *interface_type, char *netmask);
+int set_netmask(struct uci_batch *batch, char *interface_type, char *netmask);
 
 
 /**
  * @brief Set operational state of given link.
  */
  /* void set_operstate(struct rtnl_link *link, uint8_t operstate); */
-int set_operstate(struct uci_context *uctx, char *network_type, uint16_t operstate);
+int set_operstate(struct uci_batch *batch, char *network_type, uint16_t operstate);
+
+int set_origin(struct uci_batch *batch, char *network_type, char *origin);
 
 /**
  * @brief Get operational status for given interface.
  *
  * @param[in] link Link is assumed to by initialized by something like rtnl_link_get_by_name.
+ * @return Static string matching ietf-interfaces oper-status enumeration.
+ */
+const char *get_operstate(struct rtnl_link *link);
+
+/**
+ * @brief Get iana-if-type identity for given interface.
+ *
+ * @param[in] link Link is assumed to by initialized by something like rtnl_link_get_by_name.
+ */
+const char *get_if_type(struct rtnl_link *link);
+
+/**
+ * @brief Get speed of interface in bits per second.
+ *
+ * Speed is read from sysfs since it is not part of rtnetlink link message.
+ *
+ * @param[in] ifname Interface name.
+ * @param[out] speed Speed in bits per second.
+ * @return 0 on success, -1 if speed is not known for given interface.
  */
- char * get_operstate(struct rtnl_link *link);
+int get_speed(const char *ifname, uint64_t *speed);
 
 
 
@@ -119,6 +365,9 @@ void print_tc_info(struct tc_info_entry *tc_info, uint32_t count);
  * @brief Get statistics for an link representing interface.
  *
  * @param[in] link Link is assumed to by initialized by something like rtnl_link_get_by_name.
+ * @param[in,out] tc_info Entries named by libnl statistics names to fill with values.
+ * @param[in] count Number of entries.
  */
-void get_tc_info(struct rtnl_link *link);
+void get_tc_info(struct rtnl_link *link, struct tc_info_entry *tc_info, uint32_t count);
 
+#endif /* __FUNCTIONS_H__ */
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "linkmon.h"
+#include "functions.h"
+#include "common.h"
+
+/* Send queued events, nothing else is locked while sending. */
+static void
+link_monitor_flush(struct link_monitor *mon)
+{
+    struct link_event *events;
+    size_t count;
+
+    pthread_mutex_lock(&mon->lock);
+    events = mon->events;
+    count = mon->count;
+    mon->events = NULL;
+    mon->count = 0;
+    mon->size = 0;
+    pthread_mutex_unlock(&mon->lock);
+
+    for (size_t i = 0; i < count; i++) {
+        mon->send(&events[i], mon->arg);
+    }
+    free(events);
+
+    pthread_mutex_lock(&mon->lock);
+    mon->sent += count;
+    pthread_mutex_unlock(&mon->lock);
+}
+
+static void *
+link_monitor_thread(void *arg)
+{
+    struct link_monitor *mon = arg;
+    struct pollfd pfds[LINK_MONITOR_MAX_FDS + 1];
+    char buf[64];
+    bool ready;
+    bool stop;
+    bool kicked;
+
+    for (size_t i = 0; i < mon->fds_cnt; i++) {
+        pfds[i] = (struct pollfd) { .fd = mon->fds[i], .events = POLLIN };
+    }
+    pfds[mon->fds_cnt] = (struct pollfd) { .fd = mon->wake[0], .events = POLLIN };
+
+    for (;;) {
+        if (poll(pfds, mon->fds_cnt + 1, -1) < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            ERR("link monitor poll failed: %s", strerror(errno));
+            break;
+        }
+
+        if (pfds[mon->fds_cnt].revents) {
+            while (read(mon->wake[0], buf, sizeof(buf)) > 0);
+        }
+
+        pthread_mutex_lock(&mon->lock);
+        kicked = mon->kicked;
+        mon->kicked = false;
+        pthread_mutex_unlock(&mon->lock);
+
+        ready = kicked;
+        for (size_t i = 0; i < mon->fds_cnt; i++) {
+            ready |= 0 != pfds[i].revents;
+        }
+        if (ready) {
+            mon->drain(mon->arg);
+        }
+
+        link_monitor_flush(mon);
+
+        pthread_mutex_lock(&mon->lock);
+        stop = mon->stop;
+        pthread_mutex_unlock(&mon->lock);
+        if (stop) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+int
+link_monitor_start(struct link_monitor *mon, const int *fds, size_t fds_cnt,
+                   link_monitor_drain_cb drain, link_monitor_send_cb send, void *arg)
+{
+    memset(mon, 0, sizeof(*mon));
+
+    if (fds_cnt > LINK_MONITOR_MAX_FDS) {
+        return -1;
+    }
+    memcpy(mon->fds, fds, fds_cnt * sizeof(*fds));
+    mon->fds_cnt = fds_cnt;
+    mon->drain = drain;
+    mon->send = send;
+    mon->arg = arg;
+
+    if (pipe(mon->wake)) {
+        return -1;
+    }
+    fcntl(mon->wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(mon->wake[1], F_SETFL, O_NONBLOCK);
+
+    if (pthread_mutex_init(&mon->lock, NULL)) {
+        goto error;
+    }
+
+    if (pthread_create(&mon->thread, NULL, link_monitor_thread, mon)) {
+        pthread_mutex_destroy(&mon->lock);
+        goto error;
+    }
+
+    return 0;
+
+  error:
+    close(mon->wake[0]);
+    close(mon->wake[1]);
+    return -1;
+}
+
+static void
+link_monitor_wake(struct link_monitor *mon)
+{
+    /* Full pipe already wakes thread. */
+    if (write(mon->wake[1], "", 1) < 0 && EAGAIN != errno) {
+        WRN("link monitor wake failed: %s", strerror(errno));
+    }
+}
+
+void
+link_monitor_stop(struct link_monitor *mon)
+{
+    pthread_mutex_lock(&mon->lock);
+    mon->stop = true;
+    pthread_mutex_unlock(&mon->lock);
+
+    link_monitor_wake(mon);
+    pthread_join(mon->thread, NULL);
+
+    free(mon->events);
+    close(mon->wake[0]);
+    close(mon->wake[1]);
+    pthread_mutex_destroy(&mon->lock);
+}
+
+void
+link_monitor_kick(struct link_monitor *mon)
+{
+    pthread_mutex_lock(&mon->lock);
+    mon->kicked = true;
+    pthread_mutex_unlock(&mon->lock);
+
+    link_monitor_wake(mon);
+}
+
+void
+link_monitor_queue(struct link_monitor *mon, const struct link_event *event)
+{
+    struct link_event *events;
+    bool wake = false;
+    size_t size;
+
+    pthread_mutex_lock(&mon->lock);
+
+    if (mon->count >= LINK_MONITOR_MAX_EVENTS) {
+        mon->dropped++;
+        goto exit;
+    }
+
+    if (mon->count == mon->size) {
+        size = mon->size ? mon->size * 2 : 16;
+        events = realloc(mon->events, size * sizeof(*events));
+        if (!events) {
+            mon->dropped++;
+            goto exit;
+        }
+        mon->events = events;
+        mon->size = size;
+    }
+
+    mon->events[mon->count++] = *event;
+    wake = 1 == mon->count;
+
+  exit:
+    pthread_mutex_unlock(&mon->lock);
+
+    /* Events queued outside of monitor thread are sent right away too. */
+    if (wake) {
+        link_monitor_wake(mon);
+    }
+}
+
+void
+link_monitor_counters(struct link_monitor *mon, uint64_t *sent, uint64_t *dropped)
+{
+    pthread_mutex_lock(&mon->lock);
+    *sent = mon->sent;
+    *dropped = mon->dropped;
+    pthread_mutex_unlock(&mon->lock);
+}
+
+unsigned int
+link_history_update(struct link_history *history, struct rtnl_link *link)
+{
+    const char *oper_status = get_operstate(link);
+    bool admin_up = rtnl_link_get_flags(link) & IFF_UP;
+    uint8_t carrier = rtnl_link_get_carrier(link);
+    uint32_t carrier_changes;
+    unsigned int changed = 0;
+
+    if (history->valid) {
+        if (strcmp(history->oper_status, oper_status)) {
+            changed |= LINK_CHANGE_OPER;
+        }
+        if (admin_up != history->admin_up) {
+            changed |= LINK_CHANGE_ADMIN;
+        }
+        if (carrier != history->carrier) {
+            history->carrier_changes++;
+        }
+    }
+
+    /* Kernel count includes changes made before plugin started. */
+    if (0 == rtnl_link_get_carrier_changes(link, &carrier_changes)) {
+        history->carrier_changes = carrier_changes;
+    }
+
+    if (changed & LINK_CHANGE_OPER) {
+        clock_gettime(CLOCK_MONOTONIC, &history->changed_mono);
+        clock_gettime(CLOCK_REALTIME, &history->last_change);
+        history->changed = true;
+    }
+    if (changed & LINK_CHANGE_ADMIN) {
+        clock_gettime(CLOCK_REALTIME, &history->admin_change);
+        history->admin_changed = true;
+    }
+
+    history->valid = true;
+    history->oper_status = oper_status;
+    history->admin_up = admin_up;
+    history->carrier = carrier;
+
+    return changed;
+}
+
+char *
+link_date(const struct timespec *stamp, char *buf, size_t size)
+{
+    struct tm tm;
+    size_t len;
+
+    gmtime_r(&stamp->tv_sec, &tm);
+    len = strftime(buf, size, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buf + len, size - len, ".%06ldZ", stamp->tv_nsec / 1000);
+
+    return buf;
+}
@@ -0,0 +1,119 @@
+#ifndef __LINKMON_H__
+#define __LINKMON_H__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include <net/if.h>
+#include <libnl3/netlink/route/link.h>
+
+#define LINK_MONITOR_MAX_FDS 4
+#define LINK_MONITOR_MAX_EVENTS 1024    /* queued notifications, later ones are dropped */
+#define LINK_DATE_LEN 32                /* yang:date-and-time with microseconds */
+
+/* Transitions reported by link_history_update. */
+#define LINK_CHANGE_OPER 0x1
+#define LINK_CHANGE_ADMIN 0x2
+
+/* Link state last seen by monitor, kept per interface. */
+struct link_history {
+    bool valid;
+    const char *oper_status;        /* static string */
+    bool admin_up;
+    uint8_t carrier;
+    bool changed;                   /* oper status changed since start */
+    struct timespec changed_mono;   /* CLOCK_MONOTONIC of last oper change */
+    struct timespec last_change;    /* CLOCK_REALTIME of last oper change, served as last-change */
+    bool admin_changed;             /* admin status changed since start */
+    struct timespec admin_change;   /* CLOCK_REALTIME of last admin change */
+    uint32_t carrier_changes;
+};
+
+/* Oper status transition to be notified. */
+struct link_event {
+    char name[IF_NAMESIZE];
+    const char *oper_status;        /* static string */
+    bool admin_up;
+    struct timespec stamp;          /* CLOCK_REALTIME */
+};
+
+/**
+ * @brief Apply pending netlink notifications, called from monitor thread
+ * when one of its descriptors becomes readable or monitor is kicked.
+ */
+typedef void (*link_monitor_drain_cb)(void *arg);
+
+/**
+ * @brief Send one queued event, called from monitor thread without locks held.
+ */
+typedef void (*link_monitor_send_cb)(const struct link_event *event, void *arg);
+
+/**
+ * Link state monitor.
+ *
+ * Thread waits on netlink notification sockets and drains them as soon
+ * as they become readable, so link transitions are recorded when they
+ * happen rather than when operational data is next requested. Events
+ * queued while draining are sent once caller's locks are released.
+ */
+struct link_monitor {
+    pthread_t thread;
+    pthread_mutex_t lock;           /* protects queue and counters */
+    int wake[2];                    /* pipe to wake thread */
+    bool stop;
+    bool kicked;                    /* drain even if no descriptor is readable */
+    int fds[LINK_MONITOR_MAX_FDS];
+    size_t fds_cnt;
+    struct link_event *events;
+    size_t count;
+    size_t size;
+    uint64_t sent;
+    uint64_t dropped;
+    link_monitor_drain_cb drain;
+    link_monitor_send_cb send;
+    void *arg;
+};
+
+/**
+ * @brief Start monitor thread waiting on given descriptors.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int link_monitor_start(struct link_monitor *mon, const int *fds, size_t fds_cnt,
+                       link_monitor_drain_cb drain, link_monitor_send_cb send, void *arg);
+
+/**
+ * @brief Stop monitor thread, queued events are sent first.
+ */
+void link_monitor_stop(struct link_monitor *mon);
+
+/**
+ * @brief Make monitor thread call drain callback even if nothing is readable.
+ */
+void link_monitor_kick(struct link_monitor *mon);
+
+/**
+ * @brief Queue event to be sent by monitor thread, may be called from any thread.
+ */
+void link_monitor_queue(struct link_monitor *mon, const struct link_event *event);
+
+void link_monitor_counters(struct link_monitor *mon, uint64_t *sent, uint64_t *dropped);
+
+/**
+ * @brief Record state of link.
+ *
+ * First call only takes baseline. Later calls stamp oper and admin
+ * transitions separately, only oper ones move last-change. Carrier
+ * changes are taken from kernel if it reports them, counted otherwise.
+ *
+ * @return LINK_CHANGE_* flags of transitions, 0 if there were none.
+ */
+unsigned int link_history_update(struct link_history *history, struct rtnl_link *link);
+
+/**
+ * @brief Format CLOCK_REALTIME stamp as yang:date-and-time.
+ */
+char *link_date(const struct timespec *stamp, char *buf, size_t size);
+
+#endif /* __LINKMON_H__ */
@@ -0,0 +1,362 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "neighindex.h"
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+/* FNV-1a over interface, family and destination address. */
+static uint32_t
+neigh_hash(int ifindex, int family, const void *addr, size_t len)
+{
+    const uint8_t *p = addr;
+    uint32_t hash = FNV_OFFSET;
+
+    hash = (hash ^ (uint32_t) ifindex) * FNV_PRIME;
+    hash = (hash ^ (uint32_t) family) * FNV_PRIME;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static struct list_head *
+buckets_alloc(size_t count)
+{
+    struct list_head *buckets = malloc(count * sizeof(*buckets));
+
+    if (!buckets) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        INIT_LIST_HEAD(&buckets[i]);
+    }
+
+    return buckets;
+}
+
+static struct list_head *
+if_bucket(struct list_head *buckets, size_t size, int ifindex)
+{
+    return &buckets[(size_t) ifindex & (size - 1)];
+}
+
+static struct list_head *
+key_bucket(struct list_head *buckets, size_t size, uint32_t hash)
+{
+    return &buckets[hash & (size - 1)];
+}
+
+/* Double interface buckets, on allocation failure chains get longer. */
+static void
+neigh_index_grow_ifaces(struct neigh_index *idx)
+{
+    struct list_head *buckets;
+    struct if_neighs *ifn, *tmp;
+    size_t size = idx->ifaces_size * 2;
+
+    buckets = buckets_alloc(size);
+    if (!buckets) {
+        return;
+    }
+
+    for (size_t i = 0; i < idx->ifaces_size; i++) {
+        list_for_each_entry_safe(ifn, tmp, &idx->ifaces[i], node) {
+            list_del(&ifn->node);
+            list_add(&ifn->node, if_bucket(buckets, size, ifn->ifindex));
+        }
+    }
+
+    free(idx->ifaces);
+    idx->ifaces = buckets;
+    idx->ifaces_size = size;
+}
+
+/* Double key buckets, hash is stored in entry so nothing is recomputed. */
+static void
+neigh_index_grow_keys(struct neigh_index *idx)
+{
+    struct list_head *buckets;
+    struct neigh_entry *entry, *tmp;
+    size_t size = idx->keys_size * 2;
+
+    buckets = buckets_alloc(size);
+    if (!buckets) {
+        return;
+    }
+
+    for (size_t i = 0; i < idx->keys_size; i++) {
+        list_for_each_entry_safe(entry, tmp, &idx->keys[i], node) {
+            list_del(&entry->node);
+            list_add(&entry->node, key_bucket(buckets, size, entry->hash));
+        }
+    }
+
+    free(idx->keys);
+    idx->keys = buckets;
+    idx->keys_size = size;
+}
+
+static struct if_neighs *
+if_neighs_new(struct neigh_index *idx, int ifindex)
+{
+    struct if_neighs *ifn;
+
+    if (idx->interfaces >= idx->ifaces_size * NEIGH_INDEX_MAX_LOAD) {
+        neigh_index_grow_ifaces(idx);
+    }
+
+    ifn = calloc(1, sizeof(*ifn));
+    if (!ifn) {
+        return NULL;
+    }
+
+    ifn->ifindex = ifindex;
+    for (int i = 0; i < ADDR_FAMILY_COUNT; i++) {
+        INIT_LIST_HEAD(&ifn->neighs[i]);
+    }
+    list_add(&ifn->node, if_bucket(idx->ifaces, idx->ifaces_size, ifindex));
+    idx->interfaces++;
+
+    return ifn;
+}
+
+static void
+neigh_entry_free(struct neigh_index *idx, struct neigh_entry *entry)
+{
+    list_del(&entry->head);
+    list_del(&entry->node);
+    rtnl_neigh_put(entry->neigh);
+    free(entry);
+    idx->neighbors--;
+}
+
+static void
+if_neighs_free(struct neigh_index *idx, struct if_neighs *ifn)
+{
+    struct neigh_entry *entry, *tmp;
+
+    for (int i = 0; i < ADDR_FAMILY_COUNT; i++) {
+        list_for_each_entry_safe(entry, tmp, &ifn->neighs[i], head) {
+            neigh_entry_free(idx, entry);
+        }
+    }
+
+    list_del(&ifn->node);
+    idx->interfaces--;
+    free(ifn);
+}
+
+static struct neigh_entry *
+neigh_entry_find(struct neigh_index *idx, uint32_t hash, int ifindex, int family,
+                 const void *addr, size_t len)
+{
+    struct neigh_entry *entry;
+    struct nl_addr *dst;
+
+    list_for_each_entry(entry, key_bucket(idx->keys, idx->keys_size, hash), node) {
+        if (entry->hash != hash ||
+            rtnl_neigh_get_ifindex(entry->neigh) != ifindex ||
+            rtnl_neigh_get_family(entry->neigh) != family) {
+            continue;
+        }
+        dst = rtnl_neigh_get_dst(entry->neigh);
+        if (nl_addr_get_len(dst) == len && !memcmp(nl_addr_get_binary_addr(dst), addr, len)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+struct neigh_index *
+neigh_index_new(void)
+{
+    struct neigh_index *idx;
+
+    idx = calloc(1, sizeof(*idx));
+    if (!idx) {
+        return NULL;
+    }
+
+    idx->ifaces_size = NEIGH_INDEX_INIT_BUCKETS;
+    idx->ifaces = buckets_alloc(idx->ifaces_size);
+    idx->keys_size = NEIGH_INDEX_INIT_BUCKETS;
+    idx->keys = buckets_alloc(idx->keys_size);
+    if (!idx->ifaces || !idx->keys) {
+        neigh_index_free(idx);
+        return NULL;
+    }
+
+    return idx;
+}
+
+void
+neigh_index_free(struct neigh_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+
+    if (idx->ifaces) {
+        neigh_index_clear(idx);
+    }
+    free(idx->ifaces);
+    free(idx->keys);
+    free(idx);
+}
+
+void
+neigh_index_clear(struct neigh_index *idx)
+{
+    struct if_neighs *ifn, *tmp;
+
+    for (size_t i = 0; i < idx->ifaces_size; i++) {
+        list_for_each_entry_safe(ifn, tmp, &idx->ifaces[i], node) {
+            if_neighs_free(idx, ifn);
+        }
+    }
+}
+
+struct if_neighs *
+neigh_index_find_if(struct neigh_index *idx, int ifindex)
+{
+    struct if_neighs *ifn;
+
+    list_for_each_entry(ifn, if_bucket(idx->ifaces, idx->ifaces_size, ifindex), node) {
+        if (ifn->ifindex == ifindex) {
+            return ifn;
+        }
+    }
+
+    return NULL;
+}
+
+struct rtnl_neigh *
+neigh_index_find(struct neigh_index *idx, int ifindex, int family, const void *addr, size_t len)
+{
+    struct neigh_entry *entry;
+
+    entry = neigh_entry_find(idx, neigh_hash(ifindex, family, addr, len), ifindex, family, addr, len);
+
+    return entry ? entry->neigh : NULL;
+}
+
+int
+neigh_index_add(struct neigh_index *idx, struct rtnl_neigh *neigh)
+{
+    int family = rtnl_neigh_get_family(neigh);
+    addr_family index_family = addr_index_family(family);
+    int ifindex = rtnl_neigh_get_ifindex(neigh);
+    struct nl_addr *dst = rtnl_neigh_get_dst(neigh);
+    struct neigh_entry *entry;
+    struct if_neighs *ifn;
+    uint32_t hash;
+
+    /* Bridge FDB entries share neighbor cache, they are not indexed. */
+    if (ADDR_FAMILY_COUNT == index_family || !dst) {
+        return 0;
+    }
+
+    hash = neigh_hash(ifindex, family, nl_addr_get_binary_addr(dst), nl_addr_get_len(dst));
+
+    entry = neigh_entry_find(idx, hash, ifindex, family, nl_addr_get_binary_addr(dst),
+                             nl_addr_get_len(dst));
+    if (entry) {
+        /* Cache hands over new object for changed neighbor. */
+        nl_object_get(OBJ_CAST(neigh));
+        rtnl_neigh_put(entry->neigh);
+        entry->neigh = neigh;
+        return 0;
+    }
+
+    ifn = neigh_index_find_if(idx, ifindex);
+    if (!ifn) {
+        ifn = if_neighs_new(idx, ifindex);
+        if (!ifn) {
+            return -1;
+        }
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+        if (!ifn->count[ADDR_FAMILY_INET] && !ifn->count[ADDR_FAMILY_INET6]) {
+            if_neighs_free(idx, ifn);
+        }
+        return -1;
+    }
+
+    if (idx->neighbors >= idx->keys_size * NEIGH_INDEX_MAX_LOAD) {
+        neigh_index_grow_keys(idx);
+    }
+
+    nl_object_get(OBJ_CAST(neigh));
+    entry->neigh = neigh;
+    entry->hash = hash;
+    list_add_tail(&entry->head, &ifn->neighs[index_family]);
+    list_add(&entry->node, key_bucket(idx->keys, idx->keys_size, hash));
+    ifn->count[index_family]++;
+    idx->neighbors++;
+
+    return 0;
+}
+
+void
+neigh_index_remove(struct neigh_index *idx, struct rtnl_neigh *neigh)
+{
+    int family = rtnl_neigh_get_family(neigh);
+    addr_family index_family = addr_index_family(family);
+    int ifindex = rtnl_neigh_get_ifindex(neigh);
+    struct nl_addr *dst = rtnl_neigh_get_dst(neigh);
+    struct neigh_entry *entry;
+    struct if_neighs *ifn;
+
+    if (ADDR_FAMILY_COUNT == index_family || !dst) {
+        return;
+    }
+
+    entry = neigh_entry_find(idx, neigh_hash(ifindex, family, nl_addr_get_binary_addr(dst),
+                                             nl_addr_get_len(dst)),
+                             ifindex, family, nl_addr_get_binary_addr(dst), nl_addr_get_len(dst));
+    if (!entry) {
+        return;
+    }
+
+    neigh_entry_free(idx, entry);
+
+    ifn = neigh_index_find_if(idx, ifindex);
+    if (ifn && 0 == --ifn->count[index_family] &&
+        !ifn->count[ADDR_FAMILY_INET] && !ifn->count[ADDR_FAMILY_INET6]) {
+        if_neighs_free(idx, ifn);
+    }
+}
+
+struct rebuild_arg {
+    struct neigh_index *idx;
+    int rc;
+};
+
+static void
+rebuild_cb(struct nl_object *obj, void *data)
+{
+    struct rebuild_arg *arg = data;
+
+    if (neigh_index_add(arg->idx, (struct rtnl_neigh *) obj)) {
+        arg->rc = -1;
+    }
+}
+
+int
+neigh_index_rebuild(struct neigh_index *idx, struct nl_cache *cache)
+{
+    struct rebuild_arg arg = { .idx = idx, .rc = 0 };
+
+    neigh_index_clear(idx);
+    nl_cache_foreach(cache, rebuild_cb, &arg);
+
+    return arg.rc;
+}
@@ -0,0 +1,85 @@
+#ifndef __NEIGHINDEX_H__
+#define __NEIGHINDEX_H__
+
+#include <stddef.h>
+#include <inttypes.h>
+#include <libubox/list.h>
+#include <libnl3/netlink/cache.h>
+#include <libnl3/netlink/route/neighbour.h>
+
+#include "addrindex.h"
+
+#define NEIGH_INDEX_INIT_BUCKETS 256
+#define NEIGH_INDEX_MAX_LOAD 2      /* average entries per bucket before growing */
+
+/* One neighbor, reference to cache object is held while in index. */
+struct neigh_entry {
+    struct list_head head;          /* interface list */
+    struct list_head node;          /* key hash chain */
+    uint32_t hash;
+    struct rtnl_neigh *neigh;
+};
+
+/* Neighbors of one interface. */
+struct if_neighs {
+    struct list_head node;          /* interface hash chain */
+    int ifindex;
+    struct list_head neighs[ADDR_FAMILY_COUNT];
+    size_t count[ADDR_FAMILY_COUNT];
+};
+
+/**
+ * IPv4 and IPv6 entries of neighbor cache indexed by ifindex.
+ *
+ * Entries are also hashed by interface and destination, so a change
+ * notification is applied in constant time however many neighbors the
+ * interface has. Like address index, it follows cache from change
+ * callback and is rebuilt when cache is refilled.
+ */
+struct neigh_index {
+    struct list_head *ifaces;
+    size_t ifaces_size;
+    size_t interfaces;
+    struct list_head *keys;
+    size_t keys_size;
+    size_t neighbors;
+};
+
+#define neigh_index_for_each(ENTRY, NEIGHS, FAMILY) \
+    list_for_each_entry(ENTRY, &(NEIGHS)->neighs[FAMILY], head)
+
+struct neigh_index *neigh_index_new(void);
+void neigh_index_free(struct neigh_index *idx);
+
+void neigh_index_clear(struct neigh_index *idx);
+
+/**
+ * @brief Replace content of index with all neighbors in cache.
+ *
+ * @return 0 on success, -1 on allocation failure (index is left partial).
+ */
+int neigh_index_rebuild(struct neigh_index *idx, struct nl_cache *cache);
+
+/**
+ * @brief Add neighbor, entry with same interface and destination is replaced.
+ *
+ * @return 0 on success or for families not indexed, -1 on allocation failure.
+ */
+int neigh_index_add(struct neigh_index *idx, struct rtnl_neigh *neigh);
+
+void neigh_index_remove(struct neigh_index *idx, struct rtnl_neigh *neigh);
+
+/**
+ * @brief Get neighbors of interface.
+ *
+ * @return Neighbors or NULL if interface has none.
+ */
+struct if_neighs *neigh_index_find_if(struct neigh_index *idx, int ifindex);
+
+/**
+ * @brief Find neighbor by interface and binary destination address.
+ */
+struct rtnl_neigh *neigh_index_find(struct neigh_index *idx, int ifindex, int family,
+                                    const void *addr, size_t len);
+
+#endif /* __NEIGHINDEX_H__ */
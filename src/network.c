@@ -4,195 +4,275 @@
 #include <syslog.h>
 
 #include "network.h"
-#include "scripts.h"
+#include "stats.h"
+#include "arena.h"
+#include "registry.h"
+#include "changes.h"
+#include "apply.h"
+#include "persist.h"
+#include "scheduler.h"
+#include "rates.h"
 #include "common.h"
 
 #define MODULE "/ietf-ip"
+#define PLUGIN_MODULE "dt-network"
+#define PLUGIN_XPATH "/" PLUGIN_MODULE ":plugin"
+#define PLUGIN_STATE_XPATH "/" PLUGIN_MODULE ":plugin-state"
+#define LINK_NOTIF_XPATH "/" PLUGIN_MODULE ":link-state-change"
+#define APPLY_NOTIF_XPATH "/" PLUGIN_MODULE ":apply-complete"
+#define IPV6_MIN_MTU 1280
+
+ip_addr_origin
+string_to_origin(const char *str)
+{
+    ip_addr_origin rc = IP_ADDR_ORIGIN_OTHER;
+
+    if (!strcmp(str, "other") || !strcmp(str, "'other'")) {
+        rc = IP_ADDR_ORIGIN_OTHER;
+    }
+
+    if (!strcmp(str, "static") || !strcmp(str, "'static'")) {
+        rc = IP_ADDR_ORIGIN_STATIC;
+    }
+
+    if (!strcmp(str, "dhcp") || !strcmp(str, "'dhcp'")) {
+        rc = IP_ADDR_ORIGIN_DHCP;
+    }
+
+    if (!strcmp(str, "link_layer") || !strcmp(str, "'link_layer'")) {
+        rc = IP_ADDR_ORIGIN_LINK_LAYER;
+    }
+
+    if (!strcmp(str, "random") || !strcmp(str, "'random'")) {
+        rc = IP_ADDR_ORIGIN_RANDOM;
+    }
+
+    return rc;
+}
 
-struct list_head interfaces = LIST_HEAD_INIT(interfaces);
+char *
+origin_to_string(ip_addr_origin origin)
+{
+    switch(origin) {
+    case IP_ADDR_ORIGIN_OTHER: return "other";
+    case IP_ADDR_ORIGIN_STATIC: return "static";
+    case IP_ADDR_ORIGIN_DHCP: return "dhcp";
+    case IP_ADDR_ORIGIN_LINK_LAYER: return "link-layer";
+    case IP_ADDR_ORIGIN_RANDOM: return "random";
+    };
+
+    /* Should not be reachable. */
+    return NULL;
+}
 
-static int sysrepo_to_model(sr_session_ctx_t *sess, struct plugin_ctx *ctx);
-static int model_to_uci(struct plugin_ctx *ctx);
 
-/* Create single ipv4 interface with a given name. */
+/* Create single dual-stack interface with a given name. */
 static struct if_interface *
-make_interface_ipv4(char *name)
+make_interface(char *name, int ifindex)
 {
   struct if_interface *interface;
 
   interface = calloc(1, sizeof(*interface));
+  if (!interface) {
+      return NULL;
+  }
+  interface->ifindex = ifindex;
   interface->name = strdup(name); //calloc(1, MAX_INTERFACE_NAME);
   /* interface->type = calloc(1, MAX_INTERFACE_TYPE); */
   interface->description = calloc(1, MAX_INTERFACE_DESCRIPTION);
   interface->proto.ipv4 = calloc(1, sizeof(struct ip_v4));
+  interface->proto.ipv6 = calloc(1, sizeof(struct ip_v6));
+  if (!interface->name || !interface->description ||
+      !interface->proto.ipv4 || !interface->proto.ipv6) {
+      goto error;
+  }
   interface->proto.ipv4->enabled = true;
+  interface->link_trap = true;
+
+  /* ietf-ip defaults, overwritten by values read from kernel. */
+  interface->proto.ipv6->enabled = true;
+  interface->proto.ipv6->dup_addr_detect_transmits = 1;
+  interface->proto.ipv6->autoconf = (struct autoconf_v6) {
+      .create_global_addresses = true,
+      .temporary_valid_lifetime = 604800,
+      .temporary_preffered_lifetime = 86400,
+  };
 
   return interface;
 
 error:
+  free(interface->proto.ipv6);
+  free(interface->proto.ipv4);
+  free(interface->description);
+  free(interface->name);
   free(interface);
   return NULL;
 }
 
-
-/* Find available interfaces on the system and fill run-time model with it. */
-static int
-ls_interfaces_cb(struct nl_msg *msg, void *arg)
+static void
+free_interface(struct if_interface *interface)
 {
-  struct list_head *interfaces = (struct list_head *) arg;
-  struct if_interface *iff;
-  struct nlmsghdr *nlh = nlmsg_hdr(msg);
-  struct ifinfomsg *iface = NLMSG_DATA(nlh);
-  struct rtattr *hdr = IFLA_RTA(iface);
-  int remaining = nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*iface));
-
-  while (RTA_OK(hdr, remaining)) {
-
-      if (hdr->rta_type == IFLA_IFNAME) {
-          iff = make_interface_ipv4((char *) RTA_DATA(hdr));
-          list_add(&iff->head, interfaces);
-          INF("Found network interface %d: %s", iface->ifi_index, iff->name);
-      }
-
-      hdr = RTA_NEXT(hdr, remaining);
+  if (!interface) {
+      return;
   }
 
-  return NL_OK;
+  free(interface->name);
+  free(interface->type);
+  free(interface->description);
+  if (interface->proto.ipv4) {
+      address_list_free(&interface->proto.ipv4->addresses);
+  }
+  free(interface->proto.ipv4);
+  if (interface->proto.ipv6) {
+      address_list_free(&interface->proto.ipv6->addresses);
+  }
+  free(interface->proto.ipv6);
+  free(interface);
 }
 
 
-/* Fill rtnl_neigh structure with MAC and IP addresses. */
+/* Find available interfaces on the system and fill run-time model with it. */
 static void
-neighbor_get_addr_cb(struct nl_object *obj, void *arg)
+ls_interfaces_cb(struct nl_object *obj, void *arg)
 {
-  struct nl_addr *lladdr;
-  struct nl_addr *ipaddr;
-  struct rtnl_neigh *neigh = (struct rtnl_neigh *) obj;
-  struct neighbor_v4 *plugin_neigh = (struct neighbor_v4 *) arg;
-  char buf[MAX_ADDR_LEN];
+  struct if_registry *registry = (struct if_registry *) arg;
+  struct rtnl_link *link = (struct rtnl_link *) obj;
+  struct if_interface *iff;
+  char *name = rtnl_link_get_name(link);
 
-  lladdr = rtnl_neigh_get_lladdr(neigh);
-  SR_CHECK_NULL_RETURN_VOID(lladdr, "Can't get phys address");
+  if (rtnl_link_get_family(link) != AF_UNSPEC || !name) {
+      return;
+  }
 
-  ipaddr = rtnl_neigh_get_dst(neigh);
-  SR_CHECK_NULL_RETURN_VOID(ipaddr, "Can't get ip address");
+  iff = make_interface(name, rtnl_link_get_ifindex(link));
+  if (!iff) {
+      ERR("Can't add network interface %s", name);
+      return;
+  }
+  link_history_update(&iff->history, link);
+  registry_add(registry, iff);
+  INF("Found network interface %d: %s", iff->ifindex, iff->name);
+}
 
-  plugin_neigh->link_layer_address = nl_addr2str(lladdr, buf, MAX_ADDR_LEN);
-  plugin_neigh->ip = nl_addr2str(ipaddr, buf, MAX_ADDR_LEN);
 
-  return;
+static int
+section_entry_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct section_entry *) a)->ifname, ((const struct section_entry *) b)->ifname);
 }
 
-
-/* Fill rt model with list of neighbors. */
 static void
-neighbor_get_addr(struct neighbor_v4 *neighbor)
+section_map_clear(struct section_map *map)
 {
-  struct nl_cache *neighbor_cache;
-  struct nl_sock *sock;
-  int rc;
-
-  sock = nl_socket_alloc();
-  if (sock == NULL) {
-      ERR_MSG("neighbor socket init failed");
-      return;
-  }
-
-  rc = nl_connect(sock, NETLINK_ROUTE);
-  SR_CHECK_RET_MSG(rc, exit, "neighbor socket connect failed");
-
-  rc = rtnl_neigh_alloc_cache(sock, &neighbor_cache);
-  SR_CHECK_RET_MSG(rc, exit, "neighbor cache init failed");
+    for (size_t i = 0; i < map->count; i++) {
+        free(map->entries[i].ifname);
+        free(map->entries[i].section);
+    }
+    free(map->entries);
+    map->entries = NULL;
+    map->count = 0;
+}
 
-  nl_cache_foreach(neighbor_cache, neighbor_get_addr_cb, neighbor);
+/* Rebuild map of interface names to sections from one parse of 'network'
+ * package. Map is kept as it was if package can't be read. */
+static int
+section_map_load(struct section_map *map, struct uci_context *uctx)
+{
+    struct section_entry *entries = NULL, *tmp;
+    struct uci_package *up = NULL;
+    struct uci_element *e;
+    struct uci_section *s;
+    struct uci_option *o;
+    size_t count = 0, size = 0;
+    int rc = UCI_OK;
 
-exit: return;
-}
+    rc = uci_load(uctx, "network", &up);
+    UCI_CHECK_RET(rc, error, "Loading 'network' package failed %d", rc);
 
+    uci_foreach_element(&up->sections, e) {
+        s = uci_to_section(e);
+        o = uci_lookup_option(uctx, s, "ifname");
+        if (!o || UCI_TYPE_STRING != o->type) {
+            continue;
+        }
 
-/* Find interface type using interface name. */
-static void
-find_interface_type(struct uci_context *uctx, char *ifname, char **if_type)
-{
-  int rc = UCI_OK;
-  char path[MAX_UCI_PATH];
-  struct uci_element *e;
-  struct uci_section *s;
-  struct uci_option *o;
-  struct uci_ptr ptr;
-  struct uci_package *up;
-  char *path_fmt = "network.%s.ipaddr=%s"; /* Section and value */
-
-  rc = uci_load(uctx, "network", &up);
-  UCI_CHECK_RET(rc, error, "Loading 'network' package failed %d", rc);
-
-  if (UCI_OK != rc) {
-      WRN("Cant find package network %s %s", ifname, strerror(rc));
-      goto error;
-  }
-  uci_foreach_element(&up->sections, e) {
+        if (count == size) {
+            size = size ? size * 2 : 16;
+            tmp = realloc(entries, size * sizeof(*entries));
+            if (!tmp) {
+                goto error;
+            }
+            entries = tmp;
+        }
+        entries[count].ifname = strdup(o->v.string);
+        entries[count].section = strdup(s->e.name);
+        count++;
+        if (!entries[count - 1].ifname || !entries[count - 1].section) {
+            goto error;
+        }
+    }
+    uci_unload(uctx, up);
 
-      s =  uci_to_section(e);
-      if (!s) {
-          continue;
-      }
+    qsort(entries, count, sizeof(*entries), section_entry_cmp);
+    section_map_clear(map);
+    map->entries = entries;
+    map->count = count;
+    map->stale = false;
+    return 0;
 
-      o = uci_lookup_option(uctx, s, "ifname");
+  error:
+    if (up) {
+        uci_unload(uctx, up);
+    }
+    while (count--) {
+        free(entries[count].ifname);
+        free(entries[count].section);
+    }
+    free(entries);
+    return -1;
+}
 
-      if (o && (0 == strcmp(ifname, o->v.string))) {                /* interface name found */
-          INF("interface type is %s : %s [%s]\n", s->e.name, o->v.string, ifname);
-          *if_type = strdup(s->e.name);
-          break;
-      }
-  }
+/* Section of interface, NULL if it has none. */
+static const char *
+section_map_find(struct section_map *map, const char *ifname)
+{
+    struct section_entry key = { .ifname = (char *) ifname };
+    struct section_entry *entry;
 
-error:
-  if (up) {
-      uci_unload(uctx, up);
-      INF_MSG("UCI unloaded.");
-  }
+    entry = map->count ? bsearch(&key, map->entries, map->count, sizeof(*map->entries), section_entry_cmp) : NULL;
 
-  return NULL;
+    return entry ? entry->section : NULL;
 }
 
 
-/* Initialize list of interfaces for given context (with ipv4 kind of interfaces). */
+/* Initialize list of interfaces for given context (with ipv4 kind of interfaces).
+ * Links come from link cache, which was filled by one dump. */
 static void
 ls_interfaces(struct plugin_ctx *ctx)
 {
-  struct nl_sock *socket = nl_socket_alloc();  // Allocate new netlink socket in memory.
-  nl_connect(socket, NETLINK_ROUTE);  // Create file descriptor and bind socket.
-
-  /* Send request for all network interfaces. */
-  struct rtgenmsg rt_hdr = { .rtgen_family = AF_PACKET, };
-  nl_send_simple(socket, RTM_GETLINK, NLM_F_REQUEST | NLM_F_DUMP, &rt_hdr, sizeof(rt_hdr));
-
-  /* Retrieve the kernel's answer. */
-  nl_socket_modify_cb(socket, NL_CB_VALID, NL_CB_CUSTOM, ls_interfaces_cb, ctx->interfaces);
-  nl_recvmsgs_default(socket);
+  nl_cache_foreach(ctx->fctx->cache_link, ls_interfaces_cb, ctx->registry);
 }
 
-
-/* Restart network given time to wait before calling script.
-* Function is parameterized with number of seconds to enable
-* waiting for Sysrepo and UCI to sync.
-*/
+/* Assign UCI sections to interfaces, whole package is parsed once.
+ * Map is kept for links which appear later. */
 static void
-restart_network(int wait_time)
-{
-  pid_t restart_pid;
-
-  restart_pid = fork();
-  if (restart_pid > 0) {
-      INF("[pid=%d] Restarting network in %d seconds after module is changed.", restart_pid, wait_time);
-      sleep(wait_time);
-      execv("/etc/init.d/network", (char *[]){ "/etc/init.d/network", "restart", NULL });
-      exit(0);
-  } else {
-      INF("[pid=%d] Could not execute network restart, do it manually?", restart_pid);
+ls_sections(struct plugin_ctx *ctx)
+{
+  struct if_interface *iface;
+  const char *section;
+
+  if (section_map_load(&ctx->sections, ctx->uctx)) {
+      return;
   }
-}
 
+  registry_for_each(iface, ctx->registry) {
+      section = section_map_find(&ctx->sections, iface->name);
+      if (section && !iface->type) {
+          INF("interface type is %s : %s", section, iface->name);
+          iface->type = strdup(section);
+      }
+  }
+}
 
 /* Text representation of Sysrepo event code. */
 const char *
@@ -208,513 +288,1765 @@ ev_to_str(sr_notif_event_t ev) {
     }
 }
 
-
-/* On module change following should happen:
- * Verify event is returned, no custom verification is done.
- * On apply event, model is updated from Sysrepo.
- * UCI config is updated from model.
- * Network is restarted so UCI configuration is applied.
- */
-static int
-module_change_cb(sr_session_ctx_t *session, const char *module_name, sr_notif_event_t event, void *private_ctx)
+/* Send notification, values are freed. Session is shared by monitor,
+ * scheduler and UCI writer threads. */
+static void
+plugin_notif_send(struct plugin_ctx *ctx, const char *xpath, sr_val_t *values, size_t values_cnt)
 {
-    sr_change_iter_t *it = NULL;
-    int rc = SR_ERR_OK;
-    sr_change_oper_t oper;
-    sr_val_t *old_value = NULL;
-    sr_val_t *new_value = NULL;
-    char change_path[XPATH_MAX_LEN] = {0,};
-    struct plugin_ctx *ctx = private_ctx;
-
-    if (SR_EV_VERIFY == event) {
-        INF_MSG("Verifying event.");
-        return SR_ERR_OK;
-    }
+    int rc;
 
-    if (SR_EV_APPLY == event) {
-        INF_MSG("Applying changes.");
+    pthread_mutex_lock(&ctx->notif_lock);
+    rc = sr_event_notif_send(ctx->session, xpath, values, values_cnt, SR_EV_NOTIF_DEFAULT);
+    pthread_mutex_unlock(&ctx->notif_lock);
+    if (SR_ERR_OK != rc) {
+        WRN("Can't send notification %s: %s", xpath, sr_strerror(rc));
     }
 
-    rc = sysrepo_to_model(session, ctx);
-    SR_CHECK_RET(rc, exit, "sysrepo_to_model fail: %d", rc);
-
-    rc = model_to_uci(ctx);
-    UCI_CHECK_RET(rc, exit, "model_to_uci fail: %d", rc);
-
-    /* Restart network to apply changes. */
-    restart_network(RESTART_TIME_TO_WAIT);
-
-    return SR_ERR_OK;
-  exit:
-    ERR("Changes not applied: %d", rc);
-
-    return rc;
+    sr_free_values(values, values_cnt);
 }
 
-
-static int
-str_from_cmd(const char *cmd, const char *cmd_arg, const char *fmt, char *ptr)
+/* Record outcome of change set and announce it. */
+static void
+apply_report(struct plugin_ctx *ctx, uint64_t id, size_t interfaces, const char *result)
 {
-    int rc = 0;
-    FILE *fp;
-    char buf[BUFSIZE];
-    char cmd_buf[BUFSIZE];
-    char *cmd_fmt = "%s %s";
+    char date[LINK_DATE_LEN];
+    struct timespec now;
+    sr_val_t *v = NULL;
 
-    sprintf(cmd_buf, cmd_fmt, cmd, cmd_arg);
+    clock_gettime(CLOCK_REALTIME, &now);
 
-    if ((fp = popen(cmd_buf, "r")) == NULL) {
-        fprintf(stderr, "Error opening pipe!\n");
-        return -1;
+    pthread_mutex_lock(&ctx->apply.lock);
+    ctx->apply.completed++;
+    if (!strcmp(result, "failed")) {
+        ctx->apply.failed++;
     }
+    ctx->apply.last_result = result;
+    ctx->apply.last_time = now;
+    pthread_mutex_unlock(&ctx->apply.lock);
 
-    if (fgets(buf, BUFSIZE, fp) != NULL) {
-        sscanf(buf, fmt, ptr);
-    } else {
-        fprintf(stderr, "Error running %s command.\n", cmd);
-        return -1;
+    INF("Change set %" PRIu64 " of %zu interfaces done: %s", id, interfaces, result);
+
+    if (SR_ERR_OK != sr_new_values(4, &v)) {
+        return;
     }
 
-    rc = pclose(fp);
+    sr_val_set_xpath(&v[0], APPLY_NOTIF_XPATH "/id");
+    v[0].type = SR_UINT64_T;
+    v[0].data.uint64_val = id;
 
-    return rc;
+    sr_val_set_xpath(&v[1], APPLY_NOTIF_XPATH "/result");
+    sr_val_set_str_data(&v[1], SR_ENUM_T, result);
+
+    sr_val_set_xpath(&v[2], APPLY_NOTIF_XPATH "/interfaces");
+    v[2].type = SR_UINT32_T;
+    v[2].data.uint32_val = interfaces;
+
+    sr_val_set_xpath(&v[3], APPLY_NOTIF_XPATH "/completed");
+    sr_val_set_str_data(&v[3], SR_STRING_T, link_date(&now, date, sizeof(date)));
+
+    plugin_notif_send(ctx, APPLY_NOTIF_XPATH, v, 4);
 }
 
-static int
-int_from_cmd(const char *cmd, const char *cmd_arg, const char *fmt, void *ptr)
+/* Change set written to UCI, called from writer thread. */
+static void
+apply_done(const struct persist_job *job, int rc, void *arg)
 {
-    int rc = 0;
-    FILE *fp;
-    char buf[BUFSIZE];
+    struct plugin_ctx *ctx = arg;
 
-    char cmd_buf[BUFSIZE];
-    char *cmd_fmt = "%s %s";
+    /* Section map is read again when next link appears. */
+    pthread_mutex_lock(&ctx->fctx->lock);
+    ctx->sections.stale = true;
+    pthread_mutex_unlock(&ctx->fctx->lock);
 
-    sprintf(cmd_buf, cmd_fmt, cmd, cmd_arg);
+    apply_report(ctx, job->id, job->interfaces, rc ? "failed" : job->reload ? "reloaded" : "applied");
+}
 
-    if ((fp = popen(cmd, "r")) == NULL) {
-        fprintf(stderr, "Error opening pipe!\n");
-        return -1;
+/* Apply changes merged by scheduler.
+ * Admin state, MTU and address are applied to kernel over netlink.
+ * UCI config is updated for changed leaves in background, interfaces
+ * are reloaded by netifd only if kernel did not take some leaves.
+ * Completion is reported once configuration is written.
+ */
+static void
+apply_changes(struct change_set *set, void *arg)
+{
+    struct plugin_ctx *ctx = arg;
+    struct persist_job *job;
+    size_t incomplete;
+    uint64_t id;
+
+    pthread_mutex_lock(&ctx->apply.lock);
+    id = ++ctx->apply.started;
+    pthread_mutex_unlock(&ctx->apply.lock);
+
+    incomplete = apply_change_set(ctx->fctx, set);
+    INF("Changes applied to kernel for %zu of %zu interfaces.", set->count - incomplete, set->count);
+
+    /* IPv6 sysctls are not announced, published link state is rebuilt. */
+    pthread_mutex_lock(&ctx->fctx->lock);
+    ctx->fctx->dirty |= FCTX_DIRTY_LINK;
+    pthread_mutex_unlock(&ctx->fctx->lock);
+    if (ctx->monitor) {
+        link_monitor_kick(ctx->monitor);
     }
 
-    if (fgets(buf, BUFSIZE, fp) != NULL) {
-        sscanf(buf, fmt, ptr);
-    } else {
-        fprintf(stderr, "Error running %s command.\n", cmd);
+    /* Configuration file is written after changes are already live. */
+    job = persist_job_new(set, incomplete > 0);
+    if (!job) {
+        ERR_MSG("Changes not persisted, out of memory");
+        apply_report(ctx, id, set->count, "failed");
+        return;
     }
-
-    rc = pclose(fp);
-
-    return rc;
+    job->id = id;
+    persist_submit(ctx->persist, job);
 }
 
-/*
- * Takes configuration from the datastore and fills in the context.
+/* On module change following should happen:
+ * On verify event, changed values are checked against registry.
+ * On apply event, changed leaves are collected from change iterator
+ * and stored to model.
+ * Changes are handed to scheduler, which applies bursts of commits at once.
  */
 static int
-sysrepo_to_model(sr_session_ctx_t *sess, struct plugin_ctx *ctx)
+module_change_cb(sr_session_ctx_t *session, const char *module_name, sr_notif_event_t event, void *private_ctx)
 {
-    char xpath[XPATH_MAX_LEN];
-    sr_val_t *val= NULL;
+    struct plugin_ctx *ctx = private_ctx;
+    struct change_set set;
     int rc = SR_ERR_OK;
-    const char *xpath_fmt = "/ietf-interfaces:interfaces/interface[name='%s']/%s";
-    const char *xpath_fmt_ipv4 = "/ietf-interfaces:interfaces/interface[name='%s']/ietf-ip:ipv4/%s";
-    SRP_LOG_DBG_MSG("Sysrepo get config");
 
-    INF_MSG("List intefaces in sysrepo_to_model");
-    struct if_interface *iff;
-    list_for_each_entry(iff, ctx->interfaces, head) {
-        printf("Interface: %s\n", iff->name);
+    if (SR_EV_VERIFY != event && SR_EV_APPLY != event) {
+        return SR_ERR_OK;
     }
 
+    change_set_init(&set);
 
-    struct if_interface *iface;
-    list_for_each_entry(iface, ctx->interfaces, head) {
-        if (!iface->name) { WRN_MSG("Interface has no name!"); continue; }
-        INF("Updating model - interface %s", iface->name);
+    /* Registry is also updated by link monitor thread. */
+    pthread_mutex_lock(&ctx->fctx->lock);
 
-        /* enabled */
-        sprintf(xpath, xpath_fmt_ipv4, iface->name, "enabled");
-        rc = sr_get_item(sess, xpath, &val);
+    if (SR_EV_VERIFY == event) {
+        INF_MSG("Verifying event.");
+        rc = change_set_build(session, module_name, ctx->registry, &set, true);
         if (SR_ERR_OK == rc) {
-          INF("+++++ENABLED for %s is %d", iface->name, val->data.bool_val);
-            iface->proto.ipv4->enabled = val->data.bool_val;
-        } else {
-            INF("No enabled for interface %s", iface->name);
+            rc = change_set_verify(session, &set, ctx->registry);
         }
+        pthread_mutex_unlock(&ctx->fctx->lock);
+        change_set_free(&set);
+        return rc;
+    }
 
+    INF_MSG("Applying changes.");
 
-        /* forwarding */
-        sprintf(xpath, xpath_fmt_ipv4, iface->name, "forwarding");
-        rc = sr_get_item(sess, xpath, &val);
-        if (SR_ERR_OK == rc) {
-            iface->proto.ipv4->forwarding = val->data.bool_val;
-        } else {
-            INF("No forwarding for interface %s", iface->name);
-        }
-
-        /* origin */
-        sprintf(xpath, xpath_fmt_ipv4, iface->name, "origin");
-        rc = sr_get_item(sess, xpath, &val);
-        if (SR_ERR_OK == rc) {
-            iface->proto.ipv4->origin = string_to_origin(val->data.enum_val);
-        }
+    rc = change_set_build(session, module_name, ctx->registry, &set, false);
+    if (SR_ERR_OK == rc && set.count) {
+        change_set_store(&set, ctx->registry);
+    }
 
-        /* MTU */
-        sprintf(xpath, xpath_fmt_ipv4, iface->name, "mtu");
-        rc = sr_get_item(sess, xpath, &val);
-        if (SR_ERR_OK == rc) {
-            iface->proto.ipv4->mtu = val->data.uint16_val;
-        } else {
-            INF("No MTU for interface %s", iface->name);
-        }
+    pthread_mutex_unlock(&ctx->fctx->lock);
 
-        /* name */
-        sprintf(xpath, xpath_fmt, iface->name, "name");
-        rc = sr_get_item(sess, xpath, &val);
-        if (SR_ERR_OK == rc) {
-          WRN("ifname: %s", val->data.string_val);
-          /* iface->name = strdup(val->data.string_val); */
-        } else {
-          INF("No IFNAME for interface %s", iface->name);
-        }
+    SR_CHECK_RET(rc, exit, "change set fail: %d", rc);
 
-        /* ip */
-        sprintf(xpath, xpath_fmt_ipv4, iface->name, "address[ip='%s']/ip");
-        sprintf(xpath, xpath, iface->name, iface->proto.ipv4->address.ip);
-        rc = sr_get_item(sess, xpath, &val);
-        if (SR_ERR_OK == rc) {
-            strcpy(iface->proto.ipv4->address.ip, val->data.string_val);
-        }
+    if (0 == set.count) {
+        INF_MSG("No tracked leaves changed.");
+        goto exit;
+    }
 
-        /* prefix length */
-        sprintf(xpath, xpath_fmt_ipv4, iface->name, "address[ip='%s']/prefix_length");
-        sprintf(xpath, xpath, iface->name, iface->proto.ipv4->address.subnet.prefix_length);
-        rc = sr_get_item(sess, xpath, &val);
-        if (SR_ERR_OK == rc) {
-            iface->proto.ipv4->address.subnet.prefix_length = val->data.uint8_val;
-        }
+    scheduler_submit(ctx->scheduler, &set);
 
-        if (val) {
-            sr_free_val(val);
-        }
+    return SR_ERR_OK;
+  exit:
+    change_set_free(&set);
+    if (SR_ERR_OK != rc) {
+        ERR("Changes not applied: %d", rc);
     }
 
-    INF_MSG("Sysrepo get config end");
-    return SR_ERR_OK;
+    return rc;
 }
 
-/* Apply functions to update the system with data from run-time context. */
-/* Only options in UCI can be changed. */
-static int
-model_to_uci(struct plugin_ctx *ctx)
-{
-    int rc = UCI_OK;
-    struct uci_package *package = NULL;
-
-    INF_MSG("== MODEL TO UCI ==");
-
-    struct if_interface *iface;
-    list_for_each_entry(iface, ctx->interfaces, head) {
-        if (!iface->type) {
-            continue;
-        }
-
-        /* enabled */
-        set_operstate(ctx->uctx, iface->type, iface->proto.ipv4->enabled);
 
-        /* forwarding */
-        /* set_forwarding(link, iface->proto.ipv4->forwarding); */
+#define SEED_XPATH "/ietf-interfaces:interfaces/interface"
 
-        /* origin */
-        set_origin(ctx->uctx, iface->type, origin_to_string(iface->proto.ipv4->origin));
+static int
+val_xpath_cmp(const void *a, const void *b)
+{
+    return strcmp(((const sr_val_t *) a)->xpath, ((const sr_val_t *) b)->xpath);
+}
 
-        /* MTU */
-        set_mtu(ctx->uctx, iface->type, iface->proto.ipv4->mtu);
+/* Compare values of the same leaf. */
+static bool
+val_equal(const sr_val_t *a, const sr_val_t *b)
+{
+    if (a->type != b->type) {
+        return false;
+    }
 
-        /* ip */
-        set_ip4(ctx->uctx, iface->type, iface->proto.ipv4->address.ip);
+    switch (a->type) {
+    case SR_BOOL_T:
+        return a->data.bool_val == b->data.bool_val;
+    case SR_UINT16_T:
+        return a->data.uint16_val == b->data.uint16_val;
+    case SR_UINT32_T:
+        return a->data.uint32_val == b->data.uint32_val;
+    case SR_IDENTITYREF_T:
+        return a->data.identityref_val && b->data.identityref_val &&
+               !strcmp(a->data.identityref_val, b->data.identityref_val);
+    default:
+        return false;
+    }
+}
 
-        /* prefix length */
-        /* set_prefix_length(link, iface->proto.ipv4->address.subnet.prefix_length); */
-        /* TODO neighbor */
+/* Stage one leaf unless datastore already holds the same value.
+ * Current values are sorted by xpath. */
+static int
+seed_leaf(sr_session_ctx_t *sess, sr_val_t *current, size_t current_cnt, char *xpath, sr_val_t *val)
+{
+    sr_val_t key = { .xpath = xpath };
+    sr_val_t *found;
+    int rc;
 
-     }
+    found = current_cnt ? bsearch(&key, current, current_cnt, sizeof(*current), val_xpath_cmp) : NULL;
+    if (found && val_equal(found, val)) {
+        return 0;
+    }
 
-    INF_MSG("UCI updated by model.");
+    rc = sr_set_item(sess, xpath, val, SR_EDIT_DEFAULT);
+    if (SR_ERR_OK != rc) {
+        WRN("Error by sr_set_item: %s for %s", sr_strerror(rc), xpath);
+        return 0;
+    }
 
-  exit:
-    return rc;
+    return 1;
 }
 
-/* Fill running datastore with run-time context information. */
+/* Fill running datastore with run-time context information.
+ * Every interface is staged in one edit which is committed once, leaves
+ * already matching the system are left out. */
 static int
 sysrepo_commit_network(sr_session_ctx_t *sess, struct plugin_ctx *ctx)
 {
     char xpath[XPATH_MAX_LEN];
-    const char *xpath_fmt = "/ietf-interfaces:interfaces/interface[name='%s']/%s";
-    const char *xpath_fmt_ipv4 = "/ietf-interfaces:interfaces/interface[name='%s']/ietf-ip:ipv4/%s";
+    const char *xpath_fmt = SEED_XPATH "[name='%s']/%s";
+    const char *xpath_fmt_ipv4 = SEED_XPATH "[name='%s']/ietf-ip:ipv4/%s";
+    const char *xpath_fmt_ipv6 = SEED_XPATH "[name='%s']/ietf-ip:ipv6/%s";
+    sr_val_t *current = NULL;
+    size_t current_cnt = 0;
+    size_t staged = 0;
+    struct rtnl_link *link;
     int rc = SR_ERR_OK;
     sr_val_t val = { 0 };
     SRP_LOG_DBG_MSG("Filling Sysrepo configuration from run-time model.");
 
+    /* Current configuration of all interfaces in one request. */
+    rc = sr_get_items(sess, SEED_XPATH "//*", &current, &current_cnt);
+    if (SR_ERR_OK != rc && SR_ERR_NOT_FOUND != rc) {
+        WRN("Can't read current configuration: %s", sr_strerror(rc));
+    }
+    if (current_cnt) {
+        qsort(current, current_cnt, sizeof(*current), val_xpath_cmp);
+    }
+
     struct if_interface *iface;
-    list_for_each_entry(iface, ctx->interfaces, head) {
+    registry_for_each(iface, ctx->registry) {
+        sr_val_t key = { .xpath = xpath };
+        sr_val_t *found;
+
+        /* Trap setting lives only in datastore, model takes it over. */
+        snprintf(xpath, sizeof(xpath), xpath_fmt, iface->name, "link-up-down-trap-enable");
+        found = current_cnt ? bsearch(&key, current, current_cnt, sizeof(*current), val_xpath_cmp) : NULL;
+        if (found && SR_ENUM_T == found->type) {
+            iface->link_trap = strcmp(found->data.enum_val, "disabled");
+        }
 
-        sprintf(xpath, xpath_fmt, iface->name, "type");
+        snprintf(xpath, sizeof(xpath), xpath_fmt, iface->name, "type");
         val.type = SR_IDENTITYREF_T;
-        val.data.identityref_val = "iana-if-type:ethernetCsmacd";
-        sr_val_set_xpath(&val, xpath);
-        rc = sr_set_item(sess, xpath, &val, SR_EDIT_DEFAULT);
-        if (SR_ERR_OK != rc) {
-            WRN("Error by sr_set_item: %s for %s", sr_strerror(rc), xpath);
-        }
+        link = get_link(ctx->fctx, iface->ifindex);
+        val.data.identityref_val = (char *) (link ? get_if_type(link) : "iana-if-type:ethernetCsmacd");
+        rtnl_link_put(link);
+        staged += seed_leaf(sess, current, current_cnt, xpath, &val);
 
         /* Set forwarding. */
         val.type = SR_BOOL_T;
         val.data.bool_val = iface->proto.ipv4->forwarding;
-        sprintf(xpath, xpath_fmt_ipv4, iface->name, "forwarding");
-        rc = sr_set_item(sess, xpath,
-                         &val, SR_EDIT_DEFAULT);
-        if (SR_ERR_OK != rc) {
-            WRN("Error by sr_set_item: %s", sr_strerror(rc));
-        }
+        snprintf(xpath, sizeof(xpath), xpath_fmt_ipv4, iface->name, "forwarding");
+        staged += seed_leaf(sess, current, current_cnt, xpath, &val);
 
         /* set MTU. */
-        val.type = SR_UINT16_T;
-        val.data.uint16_val = iface->proto.ipv4->mtu;
-        sprintf(xpath, xpath_fmt_ipv4, iface->name, "mtu");
-        rc = sr_set_item(sess, xpath, &val, SR_EDIT_DEFAULT);
-        if (SR_ERR_OK != rc) {
-            ("Error by sr_set_item: %s", sr_strerror(rc));
+        if (iface->proto.ipv4->mtu) {
+            val.type = SR_UINT16_T;
+            val.data.uint16_val = iface->proto.ipv4->mtu;
+            snprintf(xpath, sizeof(xpath), xpath_fmt_ipv4, iface->name, "mtu");
+            staged += seed_leaf(sess, current, current_cnt, xpath, &val);
         }
 
         /* set ENABLED. */
         val.type = SR_BOOL_T;
         val.data.bool_val = iface->proto.ipv4->enabled;
-        sprintf(xpath, xpath_fmt_ipv4, iface->name, "enabled");
-        rc = sr_set_item(sess, xpath, &val, SR_EDIT_DEFAULT);
-        if (SR_ERR_OK != rc) {
-          WRN("Error by sr_set_item: %s", sr_strerror(rc));
+        snprintf(xpath, sizeof(xpath), xpath_fmt_ipv4, iface->name, "enabled");
+        staged += seed_leaf(sess, current, current_cnt, xpath, &val);
+
+        if (!iface->proto.ipv6) {
+            continue;
         }
 
-        /* Commit values set. */
-        rc = sr_commit(sess);
-        if (SR_ERR_OK != rc) {
-            fprintf(stderr, "Error by sr_commit: %s", sr_strerror(rc));
+        /* IPv6 enabled, forwarding and MTU. */
+        val.type = SR_BOOL_T;
+        val.data.bool_val = iface->proto.ipv6->enabled;
+        snprintf(xpath, sizeof(xpath), xpath_fmt_ipv6, iface->name, "enabled");
+        staged += seed_leaf(sess, current, current_cnt, xpath, &val);
+
+        val.data.bool_val = iface->proto.ipv6->forwarding;
+        snprintf(xpath, sizeof(xpath), xpath_fmt_ipv6, iface->name, "forwarding");
+        staged += seed_leaf(sess, current, current_cnt, xpath, &val);
+
+        /* Links with MTU below IPv6 minimum have IPv6 disabled. */
+        if (iface->proto.ipv6->mtu >= IPV6_MIN_MTU) {
+            val.type = SR_UINT32_T;
+            val.data.uint32_val = iface->proto.ipv6->mtu;
+            snprintf(xpath, sizeof(xpath), xpath_fmt_ipv6, iface->name, "mtu");
+            staged += seed_leaf(sess, current, current_cnt, xpath, &val);
         }
     }
 
-    return SR_ERR_OK;
+    if (current) {
+        sr_free_values(current, current_cnt);
+    }
+
+    INF("Seeding datastore: %zu leaves differ from system.", staged);
+    if (0 == staged) {
+        return SR_ERR_OK;
+    }
+
+    /* Commit values set. */
+    rc = sr_commit(sess);
+    if (SR_ERR_OK != rc) {
+        ERR("Error by sr_commit: %s", sr_strerror(rc));
+        sr_discard_changes(sess);
+    }
 
-  cleanup:
     return rc;
 }
 
+/* Fill model with addresses of interface, primary first.
+ * Only permanent IPv6 addresses are configuration, link-local and
+ * autoconfigured ones are operational state. */
 static int
-init_config_ipv4(struct ip_v4 *ipv4, char *interface_name)
+init_addresses(struct function_ctx *fun_ctx, struct address_list *list, int ifindex, int family)
 {
-    struct function_ctx *fun_ctx;
-    char buf[BUFSIZE];
+    struct if_address *addrs;
+    size_t count;
     int rc = 0;
 
-    fun_ctx = make_function_ctx();
+    addrs = get_addresses_alloc(fun_ctx, ifindex, family, &count);
+    for (size_t i = 0; i < count; i++) {
+        if (AF_INET6 == family &&
+            (!(addrs[i].flags & IFA_F_PERMANENT) || RT_SCOPE_LINK == addrs[i].scope)) {
+            continue;
+        }
+        if (!address_list_add(list, addrs[i].ip, addrs[i].prefix_length)) {
+            rc = -1;
+            break;
+        }
+    }
+
+    free(addrs);
+    return rc;
+}
 
-    struct rtnl_link *link = rtnl_link_get_by_name(fun_ctx->cache_link, interface_name);
+static int
+init_config_ipv4(struct function_ctx *fun_ctx, struct ip_v4 *ipv4, int ifindex)
+{
+    struct rtnl_link *link = get_link(fun_ctx, ifindex);
+    unsigned int mtu;
     SR_CHECK_NULL_GOTO(link, error, "failed to get link");
 
     // IP
-    strcpy(ipv4->address.ip, get_ip4(fun_ctx, link));
+    if (init_addresses(fun_ctx, &ipv4->addresses, ifindex, AF_INET)) {
+        ERR("Can't read addresses of interface %d", ifindex);
+    }
 
-    // MTU
-    ipv4->mtu = get_mtu(link);
+    // MTU, ietf-ip:ipv4/mtu is uint16, larger ones (loopback) are left unset
+    mtu = get_mtu(link);
+    ipv4->mtu = mtu <= UINT16_MAX ? mtu : 0;
 
     /* // ENABLED (operstate?) */
     /* ipv4->enabled = !strcmp(get_operstate(link), "UP") ? true : false; */
 
-    /* // PREFIX LENGTH */
-    /* ipv4->address.subnet.prefix_length = init_prefixlen(fun_ctx); */
-
     /* // FORWARDING */
     /* ipv4->forwarding = init_forwarding(link); */
 
-    /* // ORIGIN (uci) */
-    /* rc = str_from_cmd(cmd_origin, interface_name, "%s", buf); */
-    /* if (rc == 0) { */
-    /*     ipv4->origin = string_to_origin(buf); */
-    /* } else { */
-    /*     fprintf(stderr, "No 'origin' in uci file.\n"); */
-
-    /* } */
-
-
-    free_function_ctx(fun_ctx);
+    rtnl_link_put(link);
     return 0;
 
   error:
-    free_function_ctx(fun_ctx);
     return -1;
 }
 
+/* Read IPv6 parameters, left at defaults if IPv6 is not available. */
+static void
+init_config_ipv6(struct function_ctx *fun_ctx, struct if_interface *iface)
+{
+    struct ip_v6 *ipv6 = iface->proto.ipv6;
+    uint32_t value;
+
+    if (!get_inet6_conf(iface->name, "disable_ipv6", &value)) {
+        ipv6->enabled = !value;
+    }
+    if (!get_inet6_conf(iface->name, "forwarding", &value)) {
+        ipv6->forwarding = value;
+    }
+    if (!get_inet6_conf(iface->name, "mtu", &value)) {
+        ipv6->mtu = value;
+    }
+    if (!get_inet6_conf(iface->name, "dad_transmits", &value)) {
+        ipv6->dup_addr_detect_transmits = value;
+    }
+    if (!get_inet6_conf(iface->name, "autoconf", &value)) {
+        ipv6->autoconf.create_global_addresses = value;
+    }
+    if (!get_inet6_conf(iface->name, "use_tempaddr", &value)) {
+        ipv6->autoconf.create_temporary_addresses = value > 0;
+    }
+    if (!get_inet6_conf(iface->name, "temp_valid_lft", &value)) {
+        ipv6->autoconf.temporary_valid_lifetime = value;
+    }
+    if (!get_inet6_conf(iface->name, "temp_prefered_lft", &value)) {
+        ipv6->autoconf.temporary_preffered_lifetime = value;
+    }
+
+    if (init_addresses(fun_ctx, &ipv6->addresses, iface->ifindex, AF_INET6)) {
+        ERR("Can't read IPv6 addresses of interface %s", iface->name);
+    }
+}
+
+/* Read initial configuration of all interfaces.
+ * One link dump, one address dump (both done when caches were filled)
+ * and one UCI parse, interfaces are then looked up by index or name.
+ * Addresses come from address index. */
 static int
 init_config(struct plugin_ctx *ctx)
 {
-    char *type;
     struct if_interface *iface;
 
-    list_for_each_entry(iface, ctx->interfaces, head) {
-        INF_MSG()
+    ls_interfaces(ctx);
+    ls_sections(ctx);
+
+    registry_for_each(iface, ctx->registry) {
         if (iface->proto.ipv4) {
-            init_config_ipv4(iface->proto.ipv4, iface->name);
-            find_interface_type(ctx->uctx, iface->name, &iface->type);
+            init_config_ipv4(ctx->fctx, iface->proto.ipv4, iface->ifindex);
+        }
+        if (iface->proto.ipv6) {
+            init_config_ipv6(ctx->fctx, iface);
         }
     }
 
-    fprintf(stderr, "exit init config\n");
+    INF("Initial config read for %zu interfaces.", ctx->registry->count);
     return 0;
 }
 
-/* Handle operational data. */
-static int
-data_provider_cb(const char *cb_xpath, sr_val_t **values, size_t *values_cnt, void *private_ctx)
+/* Keep registry in line with links added, renamed or removed at runtime. */
+static void
+link_change(struct rtnl_link *link, int action, void *arg)
 {
-    char xpath[XPATH_MAX_LEN];
-    const char *xpath_fmt = "/ietf-interfaces:interfaces-state/interface[name='%s']/%s";
-    sr_val_t *v = NULL;
-    /* sr_xpath_ctx_t xp_ctx = {0}; */
-    int i_v = 0;
-    int rc = SR_ERR_OK;
-
-    printf("Data for '%s' requested.\n", xpath);
-
-    struct plugin_ctx *ctx = (struct plugin_ctx *) private_ctx;
-    char *interface_name = ctx->key; /* PLACEHOLDER */
-
+    struct plugin_ctx *ctx = arg;
     struct if_interface *iface;
-    list_for_each_entry(iface, ctx->interfaces, head) {
-        const char *if_name = iface->name;
+    const char *section;
+    unsigned int changed;
+    int ifindex = rtnl_link_get_ifindex(link);
+    char *name = rtnl_link_get_name(link);
 
-        if (sr_xpath_node_name_eq(xpath, "interface")) {
+    if (rtnl_link_get_family(link) != AF_UNSPEC || !name) {
+        return;
+    }
 
-            *values_cnt = 4;
+    iface = registry_find_index(ctx->registry, ifindex);
 
-            /* allocate space for data to return */
-            rc = sr_new_values(*values_cnt, &v);
-            if (SR_ERR_OK != rc) {
-                return rc;
-            }
+    if (NL_ACT_DEL == action) {
+        if (iface) {
+            INF("Network interface %d: %s removed", ifindex, iface->name);
+            registry_remove(ctx->registry, iface);
+            free_interface(iface);
+        }
+        return;
+    }
 
-            sprintf(xpath, xpath_fmt, if_name, "type");
-            sr_val_set_xpath(&v[i_v], xpath);
-            sr_val_set_str_data(&v[i_v], SR_IDENTITYREF_T, "ethernetCsmacd");
-            i_v++;
-
-            printf("i_v %d\n", i_v);
-            /* oper-status */
-            char buf[BUFSIZE] = { 0 };
-            str_from_cmd(cmd_enabled, interface_name, "%s", buf);
-            printf("buf %s\n", buf);
-
-            sprintf(xpath, xpath_fmt, if_name, "oper-status");
-            sr_val_set_xpath(&v[i_v], xpath);
-            sr_val_set_str_data(&v[i_v], SR_ENUM_T, buf);
-            i_v++;
-
-            printf("i_v %d\n", i_v);
-
-            /* phys address */
-            str_from_cmd(cmd_mac, interface_name, "%s", buf);
-            printf("mac %s\n", buf);
-
-            sprintf(xpath, xpath_fmt, if_name, "phys-address");
-            sr_val_set_xpath(&v[i_v], xpath);
-            sr_val_set_str_data(&v[i_v], SR_STRING_T, buf);
-            i_v++;
-
-            printf("i_v %d\n", i_v);
-            /* speed */
-            uint64_t speed = 0;
-            int_from_cmd(cmd_speed, interface_name, "%lu", &speed);
-            printf("speed %lu\n", speed);
-            sprintf(xpath, xpath_fmt, if_name, "speed");
-            sr_val_set_xpath(&v[i_v], xpath);
-            v[i_v].type = SR_UINT64_T;
-            v[i_v].data.uint64_val = speed;
-            i_v++;
-
-            printf("i_v %d\n", i_v);
-            /* statistics */
-            *values = v;
-
-        } else if (sr_xpath_node_name_eq(xpath, "statistics")) {
-
-            *values_cnt = 4;
-
-            rc = sr_new_values(*values_cnt, &v);
-            if (SR_ERR_OK != rc) {
-                return rc;
-            }
+    if (!iface) {
+        iface = make_interface(name, ifindex);
+        if (!iface) {
+            ERR("Can't add network interface %s", name);
+            return;
+        }
+        /* Sections may have been added by commits since map was read. */
+        if (ctx->sections.stale) {
+            section_map_load(&ctx->sections, ctx->uctx);
+        }
+        section = section_map_find(&ctx->sections, iface->name);
+        if (section) {
+            iface->type = strdup(section);
+        }
+        link_history_update(&iface->history, link);
+        registry_add(ctx->registry, iface);
+        INF("Found network interface %d: %s", ifindex, iface->name);
+        return;
+    }
+
+    if (strcmp(iface->name, name)) {
+        INF("Network interface %d: %s renamed to %s", ifindex, iface->name, name);
+        if (registry_rename(ctx->registry, iface, name)) {
+            ERR("Can't rename network interface %s", iface->name);
+        }
+    }
+
+    changed = link_history_update(&iface->history, link);
+    if (changed & LINK_CHANGE_ADMIN) {
+        INF("Network interface %s is administratively %s", iface->name,
+            iface->history.admin_up ? "up" : "down");
+    }
+    /* Notification and last-change follow oper status only. */
+    if (changed & LINK_CHANGE_OPER) {
+        INF("Network interface %s is %s", iface->name, iface->history.oper_status);
+        if (iface->link_trap && ctx->monitor) {
+            struct link_event event = {
+                .oper_status = iface->history.oper_status,
+                .admin_up = iface->history.admin_up,
+                .stamp = iface->history.last_change,
+            };
+
+            snprintf(event.name, sizeof(event.name), "%s", iface->name);
+            link_monitor_queue(ctx->monitor, &event);
+        }
+    }
+}
+
+static void
+link_resync_cb(struct nl_object *obj, void *arg)
+{
+    link_change((struct rtnl_link *) obj, NL_ACT_NEW, arg);
+}
+
+/* Apply pending link notifications, must be called with fctx lock held.
+ * After lost notifications whole registry is compared to link cache. */
+static void
+registry_update(struct plugin_ctx *ctx)
+{
+    struct if_interface *iface, *tmp;
+    struct rtnl_link *link;
+    int rc;
+
+    rc = update_function_ctx(ctx->fctx);
+    if (rc < 0) {
+        ERR("link cache update failed: %s", nl_geterror(rc));
+        return;
+    }
+    if (0 == rc) {
+        return;
+    }
+
+    nl_cache_foreach(ctx->fctx->cache_link, link_resync_cb, ctx);
+
+    registry_for_each_safe(iface, tmp, ctx->registry) {
+        link = get_link(ctx->fctx, iface->ifindex);
+        if (link) {
+            rtnl_link_put(link);
+            continue;
+        }
+        registry_remove(ctx->registry, iface);
+        free_interface(iface);
+    }
+}
+
+/* Send link-state-change notification, called from monitor thread. */
+static void
+link_monitor_send(const struct link_event *event, void *arg)
+{
+    struct plugin_ctx *ctx = arg;
+    char date[LINK_DATE_LEN];
+    sr_val_t *v = NULL;
+    int rc;
+
+    rc = sr_new_values(4, &v);
+    if (SR_ERR_OK != rc) {
+        return;
+    }
+
+    sr_val_set_xpath(&v[0], LINK_NOTIF_XPATH "/if-name");
+    sr_val_set_str_data(&v[0], SR_STRING_T, event->name);
+
+    sr_val_set_xpath(&v[1], LINK_NOTIF_XPATH "/oper-status");
+    sr_val_set_str_data(&v[1], SR_ENUM_T, event->oper_status);
+
+    sr_val_set_xpath(&v[2], LINK_NOTIF_XPATH "/admin-status");
+    sr_val_set_str_data(&v[2], SR_ENUM_T, event->admin_up ? "up" : "down");
+
+    sr_val_set_xpath(&v[3], LINK_NOTIF_XPATH "/last-change");
+    sr_val_set_str_data(&v[3], SR_STRING_T, link_date(&event->stamp, date, sizeof(date)));
+
+    plugin_notif_send(ctx, LINK_NOTIF_XPATH, v, 4);
+}
+
+/* Operational containers served by data provider. */
+typedef enum oper_node_e {
+    OPER_NODE_UNKNOWN,
+    OPER_NODE_INTERFACE,
+    OPER_NODE_STATISTICS,
+    OPER_NODE_IPV4,
+    OPER_NODE_IPV4_ADDRESS,
+    OPER_NODE_IPV6,
+    OPER_NODE_IPV6_ADDRESS,
+    OPER_NODE_IPV4_NEIGHBOR,
+    OPER_NODE_IPV6_NEIGHBOR,
+    OPER_NODE_RATES,
+    OPER_NODE_RATES_CURRENT,
+    OPER_NODE_RATES_AVERAGE,
+    OPER_NODE_RATES_PEAK,
+} oper_node;
+
+/* Number of values one interface contributes to each container. */
+#define OPER_INTERFACE_LEAVES 6     /* type, oper-status, last-change, phys-address, speed,
+                                     * carrier-changes */
+#define OPER_IPV4_LEAVES 1          /* mtu */
+#define OPER_IPV6_LEAVES 2          /* forwarding, mtu */
+
+/* Number of values one address contributes to address list. */
+#define OPER_ADDRESS_LEAVES 4       /* ip, prefix-length, origin, status */
+
+/* Number of values one neighbor contributes to neighbor list. */
+#define OPER_NEIGHBOR_LEAVES 5      /* ip, link-layer-address, origin, is-router, state */
+
+/* Number of values one interface contributes to each rates container. */
+#define OPER_RATE_LEAVES 4          /* in-bps, out-bps, in-pps, out-pps */
+
+/* Operational data request parsed from xpath. */
+struct oper_request {
+    oper_node node;
+    char ifname[IF_NAMESIZE];       /* empty if all interfaces are requested */
+};
+
+/* Find which container and which interface(s) are requested. */
+static int
+parse_oper_request(const char *cb_xpath, struct oper_request *req)
+{
+    sr_xpath_ctx_t state = { 0 };
+    char *xpath;
+    char *name;
+
+    memset(req, 0, sizeof(*req));
+
+    if (sr_xpath_node_name_eq(cb_xpath, "interfaces-state") ||
+        sr_xpath_node_name_eq(cb_xpath, "interface")) {
+        req->node = OPER_NODE_INTERFACE;
+    } else if (sr_xpath_node_name_eq(cb_xpath, "statistics")) {
+        req->node = OPER_NODE_STATISTICS;
+    } else if (sr_xpath_node_name_eq(cb_xpath, "ipv4")) {
+        req->node = OPER_NODE_IPV4;
+    } else if (sr_xpath_node_name_eq(cb_xpath, "ipv6")) {
+        req->node = OPER_NODE_IPV6;
+    } else if (sr_xpath_node_name_eq(cb_xpath, "address")) {
+        req->node = strstr(cb_xpath, "ipv6/") ? OPER_NODE_IPV6_ADDRESS : OPER_NODE_IPV4_ADDRESS;
+    } else if (sr_xpath_node_name_eq(cb_xpath, "neighbor")) {
+        req->node = strstr(cb_xpath, "ipv6/") ? OPER_NODE_IPV6_NEIGHBOR : OPER_NODE_IPV4_NEIGHBOR;
+    } else if (sr_xpath_node_name_eq(cb_xpath, "rates")) {
+        req->node = OPER_NODE_RATES;
+    } else if (sr_xpath_node_name_eq(cb_xpath, "current") && strstr(cb_xpath, "rates/")) {
+        req->node = OPER_NODE_RATES_CURRENT;
+    } else if (sr_xpath_node_name_eq(cb_xpath, "average") && strstr(cb_xpath, "rates/")) {
+        req->node = OPER_NODE_RATES_AVERAGE;
+    } else if (sr_xpath_node_name_eq(cb_xpath, "peak") && strstr(cb_xpath, "rates/")) {
+        req->node = OPER_NODE_RATES_PEAK;
+    } else {
+        req->node = OPER_NODE_UNKNOWN;
+        return SR_ERR_OK;
+    }
+
+    /* Key lookup modifies xpath in place. */
+    xpath = strdup(cb_xpath);
+    if (!xpath) {
+        return SR_ERR_NOMEM;
+    }
+
+    name = sr_xpath_key_value(xpath, "interface", "name", &state);
+    if (name) {
+        if (strlen(name) >= sizeof(req->ifname)) {
+            /* Can not be a name of an existing interface. */
+            req->node = OPER_NODE_UNKNOWN;
+        } else {
+            strcpy(req->ifname, name);
+        }
+    }
+
+    sr_xpath_recover(&state);
+    free(xpath);
+
+    return SR_ERR_OK;
+}
+
+/* Collect link state of one interface into table. */
+static int
+oper_collect_link(struct plugin_ctx *ctx, struct if_interface *iface, struct link_table *table)
+{
+    struct rtnl_link *link;
+    struct link_state *state;
+    uint64_t speed = 0;
+
+    link = get_link(ctx->fctx, iface->ifindex);
+    if (!link) {
+        return 0;
+    }
+
+    state = link_table_add(table);
+    if (!state) {
+        rtnl_link_put(link);
+        return -1;
+    }
+
+    snprintf(state->name, sizeof(state->name), "%s", iface->name);
+    state->ifindex = iface->ifindex;
+    state->type = get_if_type(link);
+    state->oper_status = get_operstate(link);
+    get_mac_buf(link, state->phys_address, sizeof(state->phys_address));
+    state->mtu = get_mtu(link);
+    state->last_change_known = iface->history.changed;
+    state->last_change = iface->history.last_change;
+    state->carrier_changes = iface->history.carrier_changes;
+    if (0 == get_speed(iface->name, &speed)) {
+        state->speed_known = true;
+        state->speed = speed;
+    }
+
+    rtnl_link_put(link);
+
+    state->addrs4 = get_addresses_alloc(ctx->fctx, iface->ifindex, AF_INET, &state->addrs4_cnt);
+    state->addrs6 = get_addresses_alloc(ctx->fctx, iface->ifindex, AF_INET6, &state->addrs6_cnt);
+
+    /* No conf directory means IPv6 is disabled for whole system or link. */
+    if (0 == get_inet6_conf(iface->name, "mtu", &state->ipv6_mtu)) {
+        uint32_t forwarding = 0;
+
+        state->ipv6 = true;
+        get_inet6_conf(iface->name, "forwarding", &forwarding);
+        state->ipv6_forwarding = forwarding;
+    }
+
+    return 0;
+}
+
+/* Collect neighbor lists of one interface into table. */
+static int
+oper_collect_neigh(struct plugin_ctx *ctx, struct if_interface *iface, struct neigh_table *table)
+{
+    struct neigh_state *state;
+
+    state = neigh_table_add(table);
+    if (!state) {
+        return -1;
+    }
+
+    snprintf(state->name, sizeof(state->name), "%s", iface->name);
+    state->neighs4 = get_neighbors_alloc(ctx->fctx, iface->ifindex, AF_INET, &state->neighs4_cnt);
+    state->neighs6 = get_neighbors_alloc(ctx->fctx, iface->ifindex, AF_INET6, &state->neighs6_cnt);
+
+    return 0;
+}
+
+static int
+oper_collect_iface(struct plugin_ctx *ctx, snapshot_container container, struct if_interface *iface,
+                   struct snapshot_data *data)
+{
+    return SNAPSHOT_NEIGH == container ? oper_collect_neigh(ctx, iface, &data->neighs)
+                                       : oper_collect_link(ctx, iface, &data->links);
+}
+
+/* Collect counters for snapshot, ifname is NULL for all interfaces.
+ * Link and neighbor containers are served from views instead. */
+static int
+oper_collect(snapshot_container container, const char *ifname, struct snapshot_data *data, void *arg)
+{
+    struct plugin_ctx *ctx = arg;
+    int rc = 0;
+
+    if (SNAPSHOT_STATS != container) {
+        return -1;
+    }
+
+    /* Single interface is requested by name, otherwise one link dump
+     * brings counters of every interface. */
+    pthread_mutex_lock(&ctx->fctx->lock);
+    rc = stats_continuity_collect(ctx->continuity, ctx->fctx->socket, ifname, &data->stats);
+    pthread_mutex_unlock(&ctx->fctx->lock);
+
+    return rc;
+}
+
+static void
+view_data_free(void *data)
+{
+    snapshot_data_free(data);
+}
+
+/* Build state of all interfaces for one view, fctx lock is held. */
+static struct snapshot_data *
+view_build(struct plugin_ctx *ctx, snapshot_container container)
+{
+    struct snapshot_data *data;
+    struct if_interface *iface;
+
+    data = calloc(1, sizeof(*data));
+    if (!data) {
+        return NULL;
+    }
+
+    registry_for_each(iface, ctx->registry) {
+        if (oper_collect_iface(ctx, container, iface, data) < 0) {
+            snapshot_data_free(data);
+            return NULL;
+        }
+    }
+    link_table_sort(&data->links);
+    neigh_table_sort(&data->neighs);
+
+    return data;
+}
+
+/* Apply pending notifications and publish views of what changed.
+ * Publication is serialized by fctx lock, which must be held. */
+static void
+oper_refresh(struct plugin_ctx *ctx)
+{
+    struct snapshot_data *data;
+    unsigned int dirty;
+
+    registry_update(ctx);
+
+    dirty = ctx->fctx->dirty;
+    ctx->fctx->dirty = 0;
+
+    if (dirty & FCTX_DIRTY_LINK) {
+        data = view_build(ctx, SNAPSHOT_LINK);
+        if (data) {
+            view_publish(&ctx->link_view, data);
+        } else {
+            /* Retried with next change. */
+            ctx->fctx->dirty |= FCTX_DIRTY_LINK;
+        }
+    }
+
+    if (dirty & FCTX_DIRTY_NEIGH) {
+        data = view_build(ctx, SNAPSHOT_NEIGH);
+        if (data) {
+            view_publish(&ctx->neigh_view, data);
+        } else {
+            ctx->fctx->dirty |= FCTX_DIRTY_NEIGH;
+        }
+    }
+}
+
+/* Drain notifications as soon as they arrive and publish new state,
+ * called from monitor thread. Readers keep using previous views until
+ * new ones are swapped in. */
+static void
+link_monitor_drain(void *arg)
+{
+    struct plugin_ctx *ctx = arg;
+
+    pthread_mutex_lock(&ctx->fctx->lock);
+    oper_refresh(ctx);
+    pthread_mutex_unlock(&ctx->fctx->lock);
+}
+
+/* Xpath of interface list entry, shared by all its values. */
+static char *
+oper_prefix(struct oper_arena *arena, const char *ifname)
+{
+    return arena_printf(arena, "/ietf-interfaces:interfaces-state/interface[name='%s']", ifname);
+}
+
+/* Fill values of interface list entry. */
+static void
+oper_fill_interface(struct snapshot_data *data, struct oper_arena *arena, const char *ifname)
+{
+    struct link_state *state;
+    char date[LINK_DATE_LEN];
+    char *prefix;
+    sr_val_t *v;
+
+    state = link_find(&data->links, ifname);
+    if (!state) {
+        return;
+    }
+
+    prefix = oper_prefix(arena, ifname);
+
+    v = arena_val(arena, arena_printf(arena, "%s/type", prefix), SR_IDENTITYREF_T);
+    if (v) {
+        sr_val_set_str_data(v, SR_IDENTITYREF_T, state->type);
+    }
+
+    v = arena_val(arena, arena_printf(arena, "%s/oper-status", prefix), SR_ENUM_T);
+    if (v) {
+        sr_val_set_str_data(v, SR_ENUM_T, state->oper_status);
+    }
+
+    /* Not present until status changes after plugin start. */
+    if (state->last_change_known) {
+        v = arena_val(arena, arena_printf(arena, "%s/last-change", prefix), SR_STRING_T);
+        if (v) {
+            sr_val_set_str_data(v, SR_STRING_T, link_date(&state->last_change, date, sizeof(date)));
+        }
+    }
+
+    v = arena_val(arena, arena_printf(arena, "%s/" PLUGIN_MODULE ":carrier-changes", prefix), SR_UINT32_T);
+    if (v) {
+        v->data.uint32_val = state->carrier_changes;
+    }
+
+    if (state->phys_address[0]) {
+        v = arena_val(arena, arena_printf(arena, "%s/phys-address", prefix), SR_STRING_T);
+        if (v) {
+            sr_val_set_str_data(v, SR_STRING_T, state->phys_address);
+        }
+    }
+
+    if (state->speed_known) {
+        v = arena_val(arena, arena_printf(arena, "%s/speed", prefix), SR_UINT64_T);
+        if (v) {
+            v->data.uint64_val = state->speed;
+        }
+    }
+}
+
+/* Fill values of statistics container. */
+static void
+oper_fill_statistics(struct snapshot_data *data, struct oper_arena *arena, const char *ifname)
+{
+    struct if_stats *stats;
+    char date[LINK_DATE_LEN];
+    char *prefix;
+    sr_val_t *v;
+
+    stats = stats_find(&data->stats, ifname);
+    if (!stats) {
+        return;
+    }
+
+    prefix = oper_prefix(arena, ifname);
+
+    v = arena_val(arena, arena_printf(arena, "%s/statistics/discontinuity-time", prefix), SR_STRING_T);
+    if (v) {
+        sr_val_set_str_data(v, SR_STRING_T, link_date(&stats->discontinuity, date, sizeof(date)));
+    }
+
+    for (size_t i = 0; i < stats_leaves_cnt; i++) {
+        const struct stats_leaf *leaf = &stats_leaves[i];
+        uint64_t value = stats_leaf_value(stats, leaf);
+
+        v = arena_val(arena, arena_printf(arena, "%s/statistics/%s", prefix, leaf->name), leaf->type);
+        if (!v) {
+            continue;
+        }
+        if (SR_UINT32_T == leaf->type) {
+            /* counter32 wraps at 2^32 */
+            v->data.uint32_val = (uint32_t) value;
+        } else {
+            v->data.uint64_val = value;
+        }
+    }
+}
+
+/* Fill values of ipv4 container. */
+static void
+oper_fill_ipv4(struct snapshot_data *data, struct oper_arena *arena, const char *ifname)
+{
+    struct link_state *state;
+    sr_val_t *v;
+
+    state = link_find(&data->links, ifname);
+    if (!state) {
+        return;
+    }
+
+    /* ietf-ip:ipv4/mtu is uint16, larger MTUs (loopback) are omitted. */
+    if (state->mtu > UINT16_MAX) {
+        return;
+    }
+
+    v = arena_val(arena, arena_printf(arena, "%s/ietf-ip:ipv4/mtu", oper_prefix(arena, ifname)),
+                  SR_UINT16_T);
+    if (v) {
+        v->data.uint16_val = state->mtu;
+    }
+}
+
+/* Fill values of ipv6 container. */
+static void
+oper_fill_ipv6(struct snapshot_data *data, struct oper_arena *arena, const char *ifname)
+{
+    struct link_state *state;
+    char *prefix;
+    sr_val_t *v;
+
+    state = link_find(&data->links, ifname);
+    if (!state || !state->ipv6) {
+        return;
+    }
+
+    prefix = oper_prefix(arena, ifname);
+
+    v = arena_val(arena, arena_printf(arena, "%s/ietf-ip:ipv6/forwarding", prefix), SR_BOOL_T);
+    if (v) {
+        v->data.bool_val = state->ipv6_forwarding;
+    }
+
+    v = arena_val(arena, arena_printf(arena, "%s/ietf-ip:ipv6/mtu", prefix), SR_UINT32_T);
+    if (v) {
+        v->data.uint32_val = state->ipv6_mtu;
+    }
+}
+
+/* Map kernel address flags to ietf-ip ip-address-origin. */
+static const char *
+oper_address_origin(const struct if_address *addr, int family)
+{
+    if (addr->flags & IFA_F_TEMPORARY) {
+        return "random";
+    }
+    if (AF_INET6 == family && RT_SCOPE_LINK == addr->scope) {
+        return "link-layer";
+    }
+    if (addr->flags & IFA_F_PERMANENT) {
+        return "static";
+    }
+
+    /* Dynamic addresses come from DHCP for IPv4 and from SLAAC or
+     * DHCPv6 for IPv6, which kernel does not tell apart. */
+    return AF_INET == family ? "dhcp" : "other";
+}
+
+/* Map kernel address flags to ipv6 address status. */
+static const char *
+oper_address_status(const struct if_address *addr)
+{
+    if (addr->flags & IFA_F_DADFAILED) {
+        return "duplicate";
+    }
+    if (addr->flags & IFA_F_TENTATIVE) {
+        return addr->flags & IFA_F_OPTIMISTIC ? "optimistic" : "tentative";
+    }
+    if (addr->flags & IFA_F_DEPRECATED) {
+        return "deprecated";
+    }
+
+    return "preferred";
+}
+
+/* Fill address list of ipv4 or ipv6 container. */
+static void
+oper_fill_addresses(struct snapshot_data *data, struct oper_arena *arena, const char *ifname,
+                    int family)
+{
+    const char *container = AF_INET == family ? "ipv4" : "ipv6";
+    struct link_state *state;
+    struct if_address *addrs;
+    size_t count;
+    char *prefix;
+    char *entry;
+    sr_val_t *v;
+
+    state = link_find(&data->links, ifname);
+    if (!state) {
+        return;
+    }
+
+    addrs = AF_INET == family ? state->addrs4 : state->addrs6;
+    count = AF_INET == family ? state->addrs4_cnt : state->addrs6_cnt;
+    if (!count) {
+        return;
+    }
+
+    prefix = oper_prefix(arena, ifname);
+
+    for (size_t i = 0; i < count; i++) {
+        entry = arena_printf(arena, "%s/ietf-ip:%s/address[ip='%s']", prefix, container, addrs[i].ip);
+
+        v = arena_val(arena, arena_printf(arena, "%s/ip", entry), SR_STRING_T);
+        if (v) {
+            sr_val_set_str_data(v, SR_STRING_T, addrs[i].ip);
+        }
+
+        v = arena_val(arena, arena_printf(arena, "%s/prefix-length", entry), SR_UINT8_T);
+        if (v) {
+            v->data.uint8_val = addrs[i].prefix_length;
+        }
+
+        v = arena_val(arena, arena_printf(arena, "%s/origin", entry), SR_ENUM_T);
+        if (v) {
+            sr_val_set_str_data(v, SR_ENUM_T, oper_address_origin(&addrs[i], family));
+        }
+
+        if (AF_INET6 == family) {
+            v = arena_val(arena, arena_printf(arena, "%s/status", entry), SR_ENUM_T);
+            if (v) {
+                sr_val_set_str_data(v, SR_ENUM_T, oper_address_status(&addrs[i]));
+            }
+        }
+    }
+}
+
+/* Map neighbor state to ietf-ip neighbor-origin. */
+static const char *
+oper_neighbor_origin(const struct if_neighbor *neigh)
+{
+    if (neigh->state & NUD_PERMANENT) {
+        return "static";
+    }
+    if (neigh->state & NUD_NOARP) {
+        return "other";
+    }
+
+    /* Resolved by ARP or ND, or router known only from RA. */
+    return "dynamic";
+}
+
+/* Map neighbor state to ipv6 neighbor state, NULL if there is none. */
+static const char *
+oper_neighbor_state(const struct if_neighbor *neigh)
+{
+    if (neigh->state & NUD_INCOMPLETE) {
+        return "incomplete";
+    }
+    if (neigh->state & NUD_STALE) {
+        return "stale";
+    }
+    if (neigh->state & NUD_DELAY) {
+        return "delay";
+    }
+    if (neigh->state & NUD_PROBE) {
+        return "probe";
+    }
+    if (neigh->state & (NUD_REACHABLE | NUD_PERMANENT | NUD_NOARP)) {
+        return "reachable";
+    }
+
+    return NULL;
+}
+
+/* Fill neighbor list of ipv4 or ipv6 container. */
+static void
+oper_fill_neighbors(struct snapshot_data *data, struct oper_arena *arena, const char *ifname,
+                    int family)
+{
+    const char *container = AF_INET == family ? "ipv4" : "ipv6";
+    struct neigh_state *state;
+    struct if_neighbor *neighs;
+    const char *nud;
+    size_t count;
+    char *prefix;
+    char *entry;
+    sr_val_t *v;
+
+    state = neigh_find(&data->neighs, ifname);
+    if (!state) {
+        return;
+    }
+
+    neighs = AF_INET == family ? state->neighs4 : state->neighs6;
+    count = AF_INET == family ? state->neighs4_cnt : state->neighs6_cnt;
+    if (!count) {
+        return;
+    }
+
+    prefix = oper_prefix(arena, ifname);
+
+    for (size_t i = 0; i < count; i++) {
+        entry = arena_printf(arena, "%s/ietf-ip:%s/neighbor[ip='%s']", prefix, container, neighs[i].ip);
+
+        v = arena_val(arena, arena_printf(arena, "%s/ip", entry), SR_STRING_T);
+        if (v) {
+            sr_val_set_str_data(v, SR_STRING_T, neighs[i].ip);
+        }
+
+        if (neighs[i].lladdr[0]) {
+            v = arena_val(arena, arena_printf(arena, "%s/link-layer-address", entry), SR_STRING_T);
+            if (v) {
+                sr_val_set_str_data(v, SR_STRING_T, neighs[i].lladdr);
+            }
+        }
+
+        v = arena_val(arena, arena_printf(arena, "%s/origin", entry), SR_ENUM_T);
+        if (v) {
+            sr_val_set_str_data(v, SR_ENUM_T, oper_neighbor_origin(&neighs[i]));
+        }
+
+        if (AF_INET == family) {
+            continue;
+        }
+
+        if (neighs[i].router) {
+            arena_val(arena, arena_printf(arena, "%s/is-router", entry), SR_LEAF_EMPTY_T);
+        }
 
-            uint64_t tx = 0;
-            int_from_cmd(cmd_tx, interface_name, "%lu", &tx);
-            sprintf(xpath, xpath_fmt, if_name, "statistics/out-octets");
-            sr_val_set_xpath(&v[i_v], xpath);
-            v[i_v].type = SR_UINT64_T;
-            v[i_v].data.uint64_val = tx;
-            i_v++;
-
-            uint32_t tx_err = 0;
-            int_from_cmd(cmd_tx_err, interface_name, "%lu", &tx_err);
-            sprintf(xpath, xpath_fmt, if_name, "statistics/out-errors");
-            sr_val_set_xpath(&v[i_v], xpath);
-            v[i_v].type = SR_UINT32_T;
-            v[i_v].data.uint32_val = tx_err;
-            i_v++;
-
-            uint64_t rx = 0;
-            int_from_cmd(cmd_rx, interface_name, "%lu", &rx);
-            sprintf(xpath, xpath_fmt, if_name, "statistics/in-octets");
-            sr_val_set_xpath(&v[i_v], xpath);
-            v[i_v].type = SR_UINT64_T;
-            v[i_v].data.uint64_val = rx;
-            i_v++;
-
-            uint32_t rx_err = 0;
-            int_from_cmd(cmd_rx_err, interface_name, "%lu", &rx_err);
-            sprintf(xpath, xpath_fmt, if_name, "statistics/in-errors");
-            sr_val_set_xpath(&v[i_v], xpath);
-            v[i_v].type = SR_UINT32_T;
-            v[i_v].data.uint32_val = rx_err;
-            i_v++;
-
-            *values = v;
-
-        } else if (sr_xpath_node_name_eq(xpath, "ipv4")) {
-
-            *values_cnt = 1;
-
-            rc = sr_new_values(*values_cnt, &v);
-            if (SR_ERR_OK != rc) {
-                return rc;
+        nud = oper_neighbor_state(&neighs[i]);
+        if (nud) {
+            v = arena_val(arena, arena_printf(arena, "%s/state", entry), SR_ENUM_T);
+            if (v) {
+                sr_val_set_str_data(v, SR_ENUM_T, nud);
             }
+        }
+    }
+}
+
+/* Number of neighbors of family in collected data. */
+static size_t
+oper_neighbor_count(struct snapshot_data *data, int family)
+{
+    size_t count = 0;
 
-            uint16_t mtu = 0;
-            int_from_cmd(cmd_mtu, interface_name, "%lu", &mtu);
-            mtu = (uint16_t) mtu;
-            sprintf(xpath, xpath_fmt, if_name, "statistics/ipv4/mtu");
-            sr_val_set_xpath(&v[i_v], xpath);
-            v[i_v].type = SR_UINT16_T;
-            v[i_v].data.uint16_val = mtu;
-            i_v++;
-            *values = v;
+    for (size_t i = 0; i < data->neighs.count; i++) {
+        count += AF_INET == family ? data->neighs.entries[i].neighs4_cnt : data->neighs.entries[i].neighs6_cnt;
+    }
 
-        } else {
-            /* ipv4 and ipv6 nested containers not implemented in this example */
-            *values = NULL;
-            values_cnt = 0;
+    return count;
+}
+
+/* Number of addresses of family in collected data. */
+static size_t
+oper_address_count(struct snapshot_data *data, int family)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < data->links.count; i++) {
+        count += AF_INET == family ? data->links.entries[i].addrs4_cnt : data->links.entries[i].addrs6_cnt;
+    }
+
+    return count;
+}
+
+/* Fill values of rates container or one of its rate containers. */
+static void
+oper_fill_rates(struct plugin_ctx *ctx, oper_node node, struct snapshot_data *data,
+                struct oper_arena *arena, const char *ifname)
+{
+    const struct rate_sample *sample;
+    struct link_state *state;
+    struct rate_info info;
+    const char *container;
+    char *prefix;
+    sr_val_t *v;
+
+    state = link_find(&data->links, ifname);
+    if (!state || !ctx->rates || rates_get(ctx->rates, state->ifindex, &info)) {
+        return;
+    }
+
+    prefix = oper_prefix(arena, ifname);
+
+    switch (node) {
+    case OPER_NODE_RATES:
+        v = arena_val(arena, arena_printf(arena, "%s/" PLUGIN_MODULE ":rates/samples", prefix), SR_UINT32_T);
+        if (v) {
+            v->data.uint32_val = info.samples;
+        }
+        return;
+    case OPER_NODE_RATES_CURRENT:
+        sample = &info.last;
+        container = "current";
+        break;
+    case OPER_NODE_RATES_AVERAGE:
+        sample = &info.average;
+        container = "average";
+        break;
+    case OPER_NODE_RATES_PEAK:
+        sample = &info.peak;
+        container = "peak";
+        break;
+    default:
+        return;
+    }
+
+    prefix = arena_printf(arena, "%s/" PLUGIN_MODULE ":rates/%s", prefix, container);
+
+    v = arena_val(arena, arena_printf(arena, "%s/in-bps", prefix), SR_UINT64_T);
+    if (v) {
+        v->data.uint64_val = sample->in_bps;
+    }
+
+    v = arena_val(arena, arena_printf(arena, "%s/out-bps", prefix), SR_UINT64_T);
+    if (v) {
+        v->data.uint64_val = sample->out_bps;
+    }
+
+    v = arena_val(arena, arena_printf(arena, "%s/in-pps", prefix), SR_UINT64_T);
+    if (v) {
+        v->data.uint64_val = sample->in_pps;
+    }
+
+    v = arena_val(arena, arena_printf(arena, "%s/out-pps", prefix), SR_UINT64_T);
+    if (v) {
+        v->data.uint64_val = sample->out_pps;
+    }
+}
+
+static void
+oper_fill(struct plugin_ctx *ctx, struct oper_request *req, struct snapshot_data *data,
+          struct oper_arena *arena, const char *ifname)
+{
+    switch (req->node) {
+    case OPER_NODE_INTERFACE:
+        oper_fill_interface(data, arena, ifname);
+        break;
+    case OPER_NODE_STATISTICS:
+        oper_fill_statistics(data, arena, ifname);
+        break;
+    case OPER_NODE_IPV4:
+        oper_fill_ipv4(data, arena, ifname);
+        break;
+    case OPER_NODE_IPV4_ADDRESS:
+        oper_fill_addresses(data, arena, ifname, AF_INET);
+        break;
+    case OPER_NODE_IPV6:
+        oper_fill_ipv6(data, arena, ifname);
+        break;
+    case OPER_NODE_IPV6_ADDRESS:
+        oper_fill_addresses(data, arena, ifname, AF_INET6);
+        break;
+    case OPER_NODE_IPV4_NEIGHBOR:
+        oper_fill_neighbors(data, arena, ifname, AF_INET);
+        break;
+    case OPER_NODE_IPV6_NEIGHBOR:
+        oper_fill_neighbors(data, arena, ifname, AF_INET6);
+        break;
+    case OPER_NODE_RATES:
+    case OPER_NODE_RATES_CURRENT:
+    case OPER_NODE_RATES_AVERAGE:
+    case OPER_NODE_RATES_PEAK:
+        oper_fill_rates(ctx, req->node, data, arena, ifname);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Name of i-th interface in table serving the container. */
+static const char *
+oper_data_name(struct snapshot_data *data, snapshot_container container, size_t i)
+{
+    switch (container) {
+    case SNAPSHOT_STATS:
+        return data->stats.entries[i].name;
+    case SNAPSHOT_NEIGH:
+        return data->neighs.entries[i].name;
+    default:
+        return data->links.entries[i].name;
+    }
+}
+
+static size_t
+oper_data_count(struct snapshot_data *data, snapshot_container container)
+{
+    switch (container) {
+    case SNAPSHOT_STATS:
+        return data->stats.count;
+    case SNAPSHOT_NEIGH:
+        return data->neighs.count;
+    default:
+        return data->links.count;
+    }
+}
+
+/* Fill values of request into arena and hand them to Sysrepo. */
+static int
+oper_serve(struct plugin_ctx *ctx, struct oper_request *req, struct snapshot_data *data,
+           snapshot_container container, size_t leaves, sr_val_t **values, size_t *values_cnt)
+{
+    struct oper_arena arena;
+    size_t n_interfaces;
+    size_t n_values;
+    int rc = SR_ERR_OK;
+
+    n_interfaces = req->ifname[0] ? 1 : oper_data_count(data, container);
+    if (!n_interfaces) {
+        return SR_ERR_OK;
+    }
+
+    /* Address lists are sized by addresses in data, which may also
+     * hold other interfaces, so the count is an upper bound. */
+    n_values = n_interfaces;
+    if (OPER_NODE_IPV4_ADDRESS == req->node || OPER_NODE_IPV6_ADDRESS == req->node) {
+        n_values = oper_address_count(data, OPER_NODE_IPV4_ADDRESS == req->node ? AF_INET : AF_INET6);
+    } else if (OPER_NODE_IPV4_NEIGHBOR == req->node || OPER_NODE_IPV6_NEIGHBOR == req->node) {
+        n_values = oper_neighbor_count(data, OPER_NODE_IPV4_NEIGHBOR == req->node ? AF_INET : AF_INET6);
+    }
+
+    /* Everything request can produce is allocated up front. */
+    rc = arena_init(&arena, n_values * leaves, (n_interfaces + n_values * (leaves + 1)) * ARENA_XPATH_LEN);
+    if (SR_ERR_OK != rc) {
+        return rc;
+    }
+
+    if (req->ifname[0]) {
+        oper_fill(ctx, req, data, &arena, req->ifname);
+    } else {
+        for (size_t i = 0; i < n_interfaces; i++) {
+            oper_fill(ctx, req, data, &arena, oper_data_name(data, container, i));
+        }
+    }
+
+    arena_finish(&arena, values, values_cnt);
+    arena_release(&arena);
+
+    return SR_ERR_OK;
+}
+
+/* Handle operational data.
+ * Only container given by xpath is computed, and only for interface
+ * selected by its key if there is one. Link and neighbor state is read
+ * from published views without locks, counters are collected on request. */
+static int
+data_provider_cb(const char *cb_xpath, sr_val_t **values, size_t *values_cnt, void *private_ctx)
+{
+    struct plugin_ctx *ctx = (struct plugin_ctx *) private_ctx;
+    struct oper_request req;
+    struct snapshot_data *data;
+    struct view *view;
+    snapshot_container container;
+    unsigned int epoch;
+    size_t leaves = 0;
+    int rc = SR_ERR_OK;
+
+    INF("Data for '%s' requested.", cb_xpath);
+
+    *values = NULL;
+    *values_cnt = 0;
+
+    rc = parse_oper_request(cb_xpath, &req);
+    if (SR_ERR_OK != rc || OPER_NODE_UNKNOWN == req.node) {
+        return rc;
+    }
+
+    switch (req.node) {
+    case OPER_NODE_STATISTICS:
+        container = SNAPSHOT_STATS;
+        leaves = stats_leaves_cnt + 1;  /* counters, discontinuity-time */
+        break;
+    case OPER_NODE_INTERFACE:
+        container = SNAPSHOT_LINK;
+        leaves = OPER_INTERFACE_LEAVES;
+        break;
+    case OPER_NODE_IPV4:
+        container = SNAPSHOT_LINK;
+        leaves = OPER_IPV4_LEAVES;
+        break;
+    case OPER_NODE_IPV6:
+        container = SNAPSHOT_LINK;
+        leaves = OPER_IPV6_LEAVES;
+        break;
+    case OPER_NODE_IPV4_ADDRESS:
+    case OPER_NODE_IPV6_ADDRESS:
+        container = SNAPSHOT_LINK;
+        leaves = OPER_ADDRESS_LEAVES;
+        break;
+    case OPER_NODE_IPV4_NEIGHBOR:
+    case OPER_NODE_IPV6_NEIGHBOR:
+        container = SNAPSHOT_NEIGH;
+        leaves = OPER_NEIGHBOR_LEAVES;
+        break;
+    case OPER_NODE_RATES:
+        container = SNAPSHOT_LINK;
+        leaves = 1;                     /* samples */
+        break;
+    case OPER_NODE_RATES_CURRENT:
+    case OPER_NODE_RATES_AVERAGE:
+    case OPER_NODE_RATES_PEAK:
+        container = SNAPSHOT_LINK;
+        leaves = OPER_RATE_LEAVES;
+        break;
+    default:
+        return SR_ERR_OK;
+    }
+
+    /* Counters are not announced by notifications, requests within
+     * snapshot ttl share one collection. */
+    if (SNAPSHOT_STATS == container) {
+        data = snapshot_get(ctx->snapshot, container, req.ifname[0] ? req.ifname : NULL);
+        if (!data) {
+            return SR_ERR_OK;
         }
-        printf("Data for '%s' requested.\n", xpath);
+        rc = oper_serve(ctx, &req, data, container, leaves, values, values_cnt);
+        snapshot_put(ctx->snapshot, data);
+        return rc;
+    }
+
+    /* Without monitor thread, pending notifications are applied here. */
+    if (!ctx->monitor) {
+        pthread_mutex_lock(&ctx->fctx->lock);
+        oper_refresh(ctx);
+        pthread_mutex_unlock(&ctx->fctx->lock);
+    }
+
+    view = SNAPSHOT_NEIGH == container ? &ctx->neigh_view : &ctx->link_view;
+    data = view_read_lock(view, &epoch);
+    if (data) {
+        rc = oper_serve(ctx, &req, data, container, leaves, values, values_cnt);
+    }
+    view_read_unlock(view, epoch);
+
+    return rc;
+}
+
+/* Read plugin tuning from datastore. */
+static void
+plugin_config_load(sr_session_ctx_t *session, struct plugin_ctx *ctx)
+{
+    sr_val_t *val = NULL;
+    int rc = SR_ERR_OK;
+
+    unsigned int quiet = SCHEDULER_QUIET_DEFAULT;
+    unsigned int max_delay = SCHEDULER_DELAY_DEFAULT;
+    unsigned int interval = RATES_INTERVAL_DEFAULT;
+
+    rc = sr_get_item(session, PLUGIN_XPATH "/snapshot/ttl", &val);
+    if (SR_ERR_OK == rc) {
+        snapshot_set_ttl(ctx->snapshot, val->data.uint32_val);
+        sr_free_val(val);
+    }
+
+    rc = sr_get_item(session, PLUGIN_XPATH "/apply/quiet-window", &val);
+    if (SR_ERR_OK == rc) {
+        quiet = val->data.uint32_val;
+        sr_free_val(val);
+    }
+
+    rc = sr_get_item(session, PLUGIN_XPATH "/apply/max-delay", &val);
+    if (SR_ERR_OK == rc) {
+        max_delay = val->data.uint32_val;
+        sr_free_val(val);
+    }
+
+    scheduler_set_times(ctx->scheduler, quiet, max_delay);
+
+    rc = sr_get_item(session, PLUGIN_XPATH "/rates/interval", &val);
+    if (SR_ERR_OK == rc) {
+        interval = val->data.uint32_val;
+        sr_free_val(val);
+    }
+
+    if (ctx->rates) {
+        rates_set_interval(ctx->rates, interval);
+    }
+}
+
+static int
+plugin_change_cb(sr_session_ctx_t *session, const char *module_name, sr_notif_event_t event, void *private_ctx)
+{
+    if (SR_EV_APPLY == event) {
+        plugin_config_load(session, private_ctx);
+    }
+
+    return SR_ERR_OK;
+}
+
+/* Values of snapshot counters. */
+static int
+plugin_state_snapshot(struct plugin_ctx *ctx, sr_val_t **values, size_t *values_cnt)
+{
+    unsigned int ttl = 0;
+    uint64_t hits = 0, misses = 0, coalesced = 0;
+    sr_val_t *v = NULL;
+    int rc = SR_ERR_OK;
+
+    snapshot_counters(ctx->snapshot, &ttl, &hits, &misses, &coalesced);
+
+    rc = sr_new_values(4, &v);
+    if (SR_ERR_OK != rc) {
+        return rc;
+    }
+
+    sr_val_set_xpath(&v[0], PLUGIN_STATE_XPATH "/snapshot/ttl");
+    v[0].type = SR_UINT32_T;
+    v[0].data.uint32_val = ttl;
+
+    sr_val_set_xpath(&v[1], PLUGIN_STATE_XPATH "/snapshot/hits");
+    v[1].type = SR_UINT64_T;
+    v[1].data.uint64_val = hits;
 
+    sr_val_set_xpath(&v[2], PLUGIN_STATE_XPATH "/snapshot/misses");
+    v[2].type = SR_UINT64_T;
+    v[2].data.uint64_val = misses;
+
+    sr_val_set_xpath(&v[3], PLUGIN_STATE_XPATH "/snapshot/coalesced");
+    v[3].type = SR_UINT64_T;
+    v[3].data.uint64_val = coalesced;
+
+    *values = v;
+    *values_cnt = 4;
+
+    return SR_ERR_OK;
+}
+
+/* Values of change scheduler counters. */
+static int
+plugin_state_apply(struct plugin_ctx *ctx, sr_val_t **values, size_t *values_cnt)
+{
+    unsigned int quiet = 0, max_delay = 0;
+    uint64_t submitted = 0, applied = 0;
+    uint64_t started, completed, failed;
+    const char *last_result;
+    struct timespec last_time;
+    char date[LINK_DATE_LEN];
+    const char *state;
+    sr_val_t *v = NULL;
+    size_t cnt = 7;
+    int rc = SR_ERR_OK;
+
+    scheduler_counters(ctx->scheduler, &quiet, &max_delay, &submitted, &applied);
+
+    pthread_mutex_lock(&ctx->apply.lock);
+    started = ctx->apply.started;
+    completed = ctx->apply.completed;
+    failed = ctx->apply.failed;
+    last_result = ctx->apply.last_result;
+    last_time = ctx->apply.last_time;
+    pthread_mutex_unlock(&ctx->apply.lock);
+
+    if (started > completed) {
+        state = "applying";
+    } else if (scheduler_pending(ctx->scheduler)) {
+        state = "pending";
+    } else {
+        state = "idle";
+    }
+
+    rc = sr_new_values(last_result ? cnt + 2 : cnt, &v);
+    if (SR_ERR_OK != rc) {
+        return rc;
+    }
+
+    sr_val_set_xpath(&v[0], PLUGIN_STATE_XPATH "/apply/quiet-window");
+    v[0].type = SR_UINT32_T;
+    v[0].data.uint32_val = quiet;
+
+    sr_val_set_xpath(&v[1], PLUGIN_STATE_XPATH "/apply/max-delay");
+    v[1].type = SR_UINT32_T;
+    v[1].data.uint32_val = max_delay;
+
+    sr_val_set_xpath(&v[2], PLUGIN_STATE_XPATH "/apply/submitted");
+    v[2].type = SR_UINT64_T;
+    v[2].data.uint64_val = submitted;
+
+    sr_val_set_xpath(&v[3], PLUGIN_STATE_XPATH "/apply/applied");
+    v[3].type = SR_UINT64_T;
+    v[3].data.uint64_val = applied;
+
+    sr_val_set_xpath(&v[4], PLUGIN_STATE_XPATH "/apply/state");
+    sr_val_set_str_data(&v[4], SR_ENUM_T, state);
+
+    sr_val_set_xpath(&v[5], PLUGIN_STATE_XPATH "/apply/completed");
+    v[5].type = SR_UINT64_T;
+    v[5].data.uint64_val = completed;
+
+    sr_val_set_xpath(&v[6], PLUGIN_STATE_XPATH "/apply/failed");
+    v[6].type = SR_UINT64_T;
+    v[6].data.uint64_val = failed;
+
+    /* Not present until first change set is done. */
+    if (last_result) {
+        sr_val_set_xpath(&v[cnt], PLUGIN_STATE_XPATH "/apply/last-result");
+        sr_val_set_str_data(&v[cnt++], SR_ENUM_T, last_result);
+
+        sr_val_set_xpath(&v[cnt], PLUGIN_STATE_XPATH "/apply/last-completed");
+        sr_val_set_str_data(&v[cnt++], SR_STRING_T, link_date(&last_time, date, sizeof(date)));
+    }
+
+    *values = v;
+    *values_cnt = cnt;
+
+    return SR_ERR_OK;
+}
+
+/* Values of counter sampler state. */
+static int
+plugin_state_rates(struct plugin_ctx *ctx, sr_val_t **values, size_t *values_cnt)
+{
+    unsigned int interval = 0;
+    uint64_t rounds = 0;
+    sr_val_t *v = NULL;
+    int rc = SR_ERR_OK;
+
+    if (!ctx->rates) {
+        return SR_ERR_OK;
+    }
+
+    rates_counters(ctx->rates, &interval, &rounds);
+
+    rc = sr_new_values(2, &v);
+    if (SR_ERR_OK != rc) {
+        return rc;
+    }
+
+    sr_val_set_xpath(&v[0], PLUGIN_STATE_XPATH "/rates/interval");
+    v[0].type = SR_UINT32_T;
+    v[0].data.uint32_val = interval;
+
+    sr_val_set_xpath(&v[1], PLUGIN_STATE_XPATH "/rates/rounds");
+    v[1].type = SR_UINT64_T;
+    v[1].data.uint64_val = rounds;
+
+    *values = v;
+    *values_cnt = 2;
+
+    return SR_ERR_OK;
+}
+
+/* Values of link monitor counters. */
+static int
+plugin_state_link_monitor(struct plugin_ctx *ctx, sr_val_t **values, size_t *values_cnt)
+{
+    uint64_t sent = 0, dropped = 0;
+    sr_val_t *v = NULL;
+    int rc = SR_ERR_OK;
+
+    if (!ctx->monitor) {
+        return SR_ERR_OK;
+    }
+
+    link_monitor_counters(ctx->monitor, &sent, &dropped);
+
+    rc = sr_new_values(2, &v);
+    if (SR_ERR_OK != rc) {
+        return rc;
+    }
+
+    sr_val_set_xpath(&v[0], PLUGIN_STATE_XPATH "/link-monitor/notifications-sent");
+    v[0].type = SR_UINT64_T;
+    v[0].data.uint64_val = sent;
+
+    sr_val_set_xpath(&v[1], PLUGIN_STATE_XPATH "/link-monitor/notifications-dropped");
+    v[1].type = SR_UINT64_T;
+    v[1].data.uint64_val = dropped;
+
+    *values = v;
+    *values_cnt = 2;
+
+    return SR_ERR_OK;
+}
+
+/* Handle plugin operational data. */
+static int
+plugin_state_cb(const char *cb_xpath, sr_val_t **values, size_t *values_cnt, void *private_ctx)
+{
+    struct plugin_ctx *ctx = (struct plugin_ctx *) private_ctx;
+
+    *values = NULL;
+    *values_cnt = 0;
+
+    if (sr_xpath_node_name_eq(cb_xpath, "snapshot")) {
+        return plugin_state_snapshot(ctx, values, values_cnt);
+    }
+    if (sr_xpath_node_name_eq(cb_xpath, "apply")) {
+        return plugin_state_apply(ctx, values, values_cnt);
+    }
+    if (sr_xpath_node_name_eq(cb_xpath, "link-monitor")) {
+        return plugin_state_link_monitor(ctx, values, values_cnt);
+    }
+    if (sr_xpath_node_name_eq(cb_xpath, "rates")) {
+        return plugin_state_rates(ctx, values, values_cnt);
     }
 
     return SR_ERR_OK;
@@ -730,9 +2062,69 @@ sr_plugin_init_cb(sr_session_ctx_t *session, void **private_ctx)
     /* INF("sr_plugin_init_cb for sysrepo-plugin-dt-network"); */
 
     struct plugin_ctx *ctx = calloc(1, sizeof(*ctx));
-    ctx->key = "bla";
-    ctx->interfaces = &interfaces;
-    ls_interfaces(ctx);
+    if (!ctx) {
+        return SR_ERR_NOMEM;
+    }
+
+    view_init(&ctx->link_view, view_data_free);
+    view_init(&ctx->neigh_view, view_data_free);
+    pthread_mutex_init(&ctx->apply.lock, NULL);
+    pthread_mutex_init(&ctx->notif_lock, NULL);
+    ctx->session = session;
+
+    ctx->registry = registry_new();
+    if (!ctx->registry) {
+        rc = SR_ERR_NOMEM;
+        goto error;
+    }
+
+    /* Netlink context used for serving operational data. */
+    ctx->fctx = make_function_ctx();
+    if (!ctx->fctx) {
+        rc = SR_ERR_INIT_FAILED;
+        goto error;
+    }
+
+    ctx->snapshot = calloc(1, sizeof(*ctx->snapshot));
+    if (!ctx->snapshot || snapshot_init(ctx->snapshot, oper_collect, ctx)) {
+        free(ctx->snapshot);
+        ctx->snapshot = NULL;
+        rc = SR_ERR_INIT_FAILED;
+        goto error;
+    }
+
+    ctx->persist = calloc(1, sizeof(*ctx->persist));
+    if (!ctx->persist || persist_init(ctx->persist, apply_done, ctx)) {
+        free(ctx->persist);
+        ctx->persist = NULL;
+        rc = SR_ERR_INIT_FAILED;
+        goto error;
+    }
+
+    /* Changes are applied from scheduler thread. */
+    ctx->scheduler = calloc(1, sizeof(*ctx->scheduler));
+    if (!ctx->scheduler || scheduler_init(ctx->scheduler, apply_changes, ctx)) {
+        free(ctx->scheduler);
+        ctx->scheduler = NULL;
+        rc = SR_ERR_INIT_FAILED;
+        goto error;
+    }
+
+    ctx->continuity = calloc(1, sizeof(*ctx->continuity));
+    if (!ctx->continuity || stats_continuity_init(ctx->continuity)) {
+        free(ctx->continuity);
+        ctx->continuity = NULL;
+        rc = SR_ERR_INIT_FAILED;
+        goto error;
+    }
+
+    /* Rates are optional, interfaces are served without them. */
+    ctx->rates = calloc(1, sizeof(*ctx->rates));
+    if (!ctx->rates || rates_init(ctx->rates, ctx->continuity)) {
+        WRN_MSG("Counter sampler not started, rates are not available");
+        free(ctx->rates);
+        ctx->rates = NULL;
+    }
 
     /* Allocate UCI context for uci files. */
     ctx->uctx = uci_alloc_context();
@@ -743,12 +2135,37 @@ sr_plugin_init_cb(sr_session_ctx_t *session, void **private_ctx)
 
     /* read initial config from system */
     init_config(ctx);
+
+    /* Links appearing later are added to registry from notifications. */
+    set_link_change_cb(ctx->fctx, link_change, ctx);
+
+    /* First views are published before data provider is subscribed. */
+    pthread_mutex_lock(&ctx->fctx->lock);
+    ctx->fctx->dirty |= FCTX_DIRTY_LINK | FCTX_DIRTY_NEIGH;
+    oper_refresh(ctx);
+    pthread_mutex_unlock(&ctx->fctx->lock);
     INF_MSG("init config finish\n");
 
     /* Commit model to datastore */
     sysrepo_commit_network(session, ctx);
     INF_MSG("sysrepo commit finish\n");
 
+    *private_ctx = ctx;
+
+    /* Link transitions are recorded as they happen from now on. Monitor is
+     * started before callbacks, which read ctx->monitor, are subscribed. */
+    ctx->monitor = calloc(1, sizeof(*ctx->monitor));
+    if (ctx->monitor) {
+        int fds[LINK_MONITOR_MAX_FDS];
+        size_t fds_cnt = get_event_fds(ctx->fctx, fds, LINK_MONITOR_MAX_FDS);
+
+        if (link_monitor_start(ctx->monitor, fds, fds_cnt, link_monitor_drain, link_monitor_send, ctx)) {
+            WRN_MSG("Link monitor not started, link state is updated on request only");
+            free(ctx->monitor);
+            ctx->monitor = NULL;
+        }
+    }
+
     /* operational data */
     rc = sr_dp_get_items_subscribe(session, "/ietf-interfaces:interfaces-state", data_provider_cb, *private_ctx,
                                    SR_SUBSCR_DEFAULT, &subscription);
@@ -757,12 +2174,28 @@ sr_plugin_init_cb(sr_session_ctx_t *session, void **private_ctx)
         goto error;
     }
 
-    *private_ctx = ctx;
-
     rc = sr_module_change_subscribe(session, "ietf-interfaces", module_change_cb, *private_ctx,
-                                    0, SR_SUBSCR_DEFAULT, &subscription);
+                                    0, SR_SUBSCR_CTX_REUSE, &subscription);
     SR_CHECK_RET(rc, error, "initialization error: %s", sr_strerror(rc));
 
+    ctx->subscription = subscription;
+
+    /* Plugin tuning module is optional. */
+    plugin_config_load(session, ctx);
+
+    rc = sr_module_change_subscribe(session, PLUGIN_MODULE, plugin_change_cb, *private_ctx,
+                                    0, SR_SUBSCR_CTX_REUSE, &subscription);
+    if (SR_ERR_OK != rc) {
+        WRN("Plugin configuration not available: %s", sr_strerror(rc));
+    }
+
+    rc = sr_dp_get_items_subscribe(session, PLUGIN_STATE_XPATH, plugin_state_cb, *private_ctx,
+                                   SR_SUBSCR_CTX_REUSE, &subscription);
+    if (SR_ERR_OK != rc) {
+        WRN("Plugin state not available: %s", sr_strerror(rc));
+    }
+
+
     /* set_mtu(ctx->uctx, "wan6", 1470u); */
 
     SRP_LOG_DBG_MSG("Plugin initialized successfully");
@@ -771,8 +2204,44 @@ sr_plugin_init_cb(sr_session_ctx_t *session, void **private_ctx)
 
   error:
     SRP_LOG_ERR("Plugin initialization failed: %s", sr_strerror(rc));
-    sr_unsubscribe(session, subscription);
+    if (subscription) {
+        sr_unsubscribe(session, subscription);
+    }
+    if (ctx->snapshot) {
+        snapshot_cleanup(ctx->snapshot);
+        free(ctx->snapshot);
+    }
+    if (ctx->scheduler) {
+        scheduler_cleanup(ctx->scheduler);
+        free(ctx->scheduler);
+    }
+    if (ctx->rates) {
+        rates_cleanup(ctx->rates);
+        free(ctx->rates);
+    }
+    if (ctx->continuity) {
+        stats_continuity_cleanup(ctx->continuity);
+        free(ctx->continuity);
+    }
+    if (ctx->persist) {
+        persist_cleanup(ctx->persist);
+        free(ctx->persist);
+    }
+    if (ctx->monitor) {
+        link_monitor_stop(ctx->monitor);
+        free(ctx->monitor);
+    }
+    if (ctx->fctx) {
+        free_function_ctx(ctx->fctx);
+    }
+    view_cleanup(&ctx->link_view);
+    view_cleanup(&ctx->neigh_view);
+    pthread_mutex_destroy(&ctx->apply.lock);
+    pthread_mutex_destroy(&ctx->notif_lock);
+    section_map_clear(&ctx->sections);
+    registry_free(ctx->registry, free_interface);
     free(ctx);
+    *private_ctx = NULL;
     return rc;
 }
 
@@ -784,7 +2253,32 @@ sr_plugin_cleanup_cb(sr_session_ctx_t *session, void *private_ctx)
 
     struct plugin_ctx *ctx = private_ctx;
     sr_unsubscribe(session, ctx->subscription);
+    if (ctx->rates) {
+        rates_cleanup(ctx->rates);
+        free(ctx->rates);
+    }
+    snapshot_cleanup(ctx->snapshot);
+    free(ctx->snapshot);
+    stats_continuity_cleanup(ctx->continuity);
+    free(ctx->continuity);
+    /* Pending changes are applied and written before exit. */
+    scheduler_cleanup(ctx->scheduler);
+    free(ctx->scheduler);
+    persist_cleanup(ctx->persist);
+    free(ctx->persist);
+    /* Applies flushed above kick monitor, it goes last. */
+    if (ctx->monitor) {
+        link_monitor_stop(ctx->monitor);
+        free(ctx->monitor);
+        ctx->monitor = NULL;
+    }
     free_function_ctx(ctx->fctx);
+    view_cleanup(&ctx->link_view);
+    view_cleanup(&ctx->neigh_view);
+    pthread_mutex_destroy(&ctx->apply.lock);
+    pthread_mutex_destroy(&ctx->notif_lock);
+    section_map_clear(&ctx->sections);
+    registry_free(ctx->registry, free_interface);
     free(ctx);
 
     SRP_LOG_DBG_MSG("Plugin cleaned-up successfully");
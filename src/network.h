@@ -1,5 +1,8 @@
 /* Author: Antonio Paunovic <antonio.paunovic@sartura.hr> */
 
+#ifndef __NETWORK_H__
+#define __NETWORK_H__
+
 #include <stdbool.h>
 #include <libubox/list.h>
 
@@ -9,8 +12,11 @@
 #include "sysrepo/plugins.h"
 
 #include "functions.h"
+#include "snapshot.h"
+#include "address.h"
+#include "linkmon.h"
+#include "view.h"
 
-#define IP_SIZE 15
 #define XPATH_MAX_LEN 100
 #define BUFSIZE 256
 #define MAX_INTERFACES 10
@@ -18,7 +24,6 @@
 #define MAX_INTERFACE_TYPE 10
 #define MAX_INTERFACE_DESCRIPTION 200
 #define MAX_ADDR_LEN 32
-#define RESTART_TIME_TO_WAIT 3
 
 
 typedef char uint8;
@@ -32,48 +37,8 @@ typedef enum ip_addr_origin_s
     IP_ADDR_ORIGIN_RANDOM,
 } ip_addr_origin;
 
-ip_addr_origin
-string_to_origin(const char *str)
-{
-    ip_addr_origin rc = IP_ADDR_ORIGIN_OTHER;
-
-    if (!strcmp(str, "other") || !strcmp(str, "'other'")) {
-        rc = IP_ADDR_ORIGIN_OTHER;
-    }
-
-    if (!strcmp(str, "static") || !strcmp(str, "'static'")) {
-        rc = IP_ADDR_ORIGIN_STATIC;
-    }
-
-    if (!strcmp(str, "dhcp") || !strcmp(str, "'dhcp'")) {
-        rc = IP_ADDR_ORIGIN_DHCP;
-    }
-
-    if (!strcmp(str, "link_layer") || !strcmp(str, "'link_layer'")) {
-        rc = IP_ADDR_ORIGIN_LINK_LAYER;
-    }
-
-    if (!strcmp(str, "random") || !strcmp(str, "'random'")) {
-        rc = IP_ADDR_ORIGIN_RANDOM;
-    }
-
-    return rc;
-}
-
-char *
-origin_to_string(ip_addr_origin origin)
-{
-    switch(origin) {
-    case IP_ADDR_ORIGIN_OTHER: return "other";
-    case IP_ADDR_ORIGIN_STATIC: return "static";
-    case IP_ADDR_ORIGIN_DHCP: return "dhcp";
-    case IP_ADDR_ORIGIN_LINK_LAYER: return "link-layer";
-    case IP_ADDR_ORIGIN_RANDOM: return "random";
-    };
-
-    /* Should not be reachable. */
-    return NULL;
-}
+ip_addr_origin string_to_origin(const char *str);
+char *origin_to_string(ip_addr_origin origin);
 
 typedef enum neighbor_origin_s {
     NEIGHBOR_ORIGIN_OTHER,
@@ -82,12 +47,6 @@ typedef enum neighbor_origin_s {
 } neighbor_origin;
 
 
-struct neighbor_v4 {
-    char *ip;
-    char *link_layer_address;
-};
-
-
 struct ip_v4 {
     struct list_head neighbors;
     bool enabled;
@@ -95,52 +54,40 @@ struct ip_v4 {
     ip_addr_origin origin;
     unsigned short mtu;
 
-    struct address_v4
-    {
-        char ip[IP_SIZE+1];
-        union subnet_s
-        {
-            uint8 prefix_length;
-            char *netmask;
-        } subnet;
-    } address;
+    struct address_list addresses;
 
     /* neighbor list */
     /* subnet list */
 };
 
+struct autoconf_v6
+{
+    bool create_global_addresses;
+    bool create_temporary_addresses;
+    unsigned int temporary_valid_lifetime;
+    unsigned int temporary_preffered_lifetime;
+};
+
 struct ip_v6 {
     bool enabled;
     bool forwarding;
-    unsigned short mtu;
+    unsigned int mtu;
 
-    struct address_v6
-    {
-        char *ip;
-        uint8 prefix_length;
-    } address;
-
-    struct neighbor_v6
-    {
-        char *ip;
-        char *link_layer_address;
-    } neighbor;
+    struct address_list addresses;  /* configured (permanent, not link-local) */
 
     unsigned int dup_addr_detect_transmits;
 
-    struct autoconf_v6
-    {
-        bool create_global_addresses;
-        bool create_temporary_addresses;
-        unsigned int temporary_valid_lifetime;
-        unsigned int temporary_preffered_lifetime;
-    } autoconf;
+    struct autoconf_v6 autoconf;
 };
 
 struct if_interface {
     struct list_head head;
+    struct list_head name_node;     /* registry hash chains */
+    struct list_head index_node;
+    int ifindex;
 
-    union proto {
+    /* Both families are configured on the same interface. */
+    struct proto {
         struct ip_v4 *ipv4;
         struct ip_v6 *ipv6;
     } proto;
@@ -148,12 +95,56 @@ struct if_interface {
     char *name;                 /* eth0, enp3s0, etc. */
     char *type;                 /* wan, lan, etc. */
     char *description;
+
+    bool link_trap;             /* link-up-down-trap-enable */
+    struct link_history history;    /* oper and admin status transitions */
+};
+
+struct if_registry;
+struct persist;
+struct scheduler;
+struct rates;
+
+/* Outcome of change sets handed to scheduler, reported in plugin-state. */
+struct apply_status {
+    pthread_mutex_t lock;
+    uint64_t started;               /* change sets applied to kernel */
+    uint64_t completed;             /* change sets written, with or without success */
+    uint64_t failed;
+    const char *last_result;        /* static string, NULL before first completion */
+    struct timespec last_time;      /* CLOCK_REALTIME of last completion */
+};
+
+/* UCI section of interface, by its 'ifname' option. */
+struct section_entry {
+    char *ifname;
+    char *section;
+};
+
+/* Interface names of 'network' package mapped to their sections. */
+struct section_map {
+    struct section_entry *entries;  /* sorted by ifname */
+    size_t count;
+    bool stale;                     /* configuration committed since map was read */
 };
 
 struct plugin_ctx {
-    struct list_head *interfaces;
-    char *key;                  /* interface name */
+    struct if_registry *registry;   /* interfaces by name and ifindex */
     sr_subscription_ctx_t *subscription;
     struct function_ctx *fctx;  /* context for using libnl functions */
+    struct snapshot *snapshot;  /* recently collected operational data */
+    struct persist *persist;    /* background UCI writer */
+    struct scheduler *scheduler;    /* debounce of configuration changes */
     struct uci_context *uctx;       /* initialization TODO ? */
+    struct link_monitor *monitor;   /* link transitions and notifications */
+    sr_session_ctx_t *session;      /* used for notifications, see plugin_notif_send */
+    pthread_mutex_t notif_lock;     /* notifications are sent from several threads */
+    struct rates *rates;            /* background counter sampler */
+    struct stats_continuity *continuity;    /* counters across interface resets */
+    struct view link_view;          /* link state published by monitor thread */
+    struct view neigh_view;         /* neighbor lists published by monitor thread */
+    struct apply_status apply;
+    struct section_map sections;    /* protected by fctx lock */
 };
+
+#endif /* __NETWORK_H__ */
@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "persist.h"
+#include "common.h"
+
+/* netifd reloads only interfaces with changed configuration. */
+#define NETWORK_RELOAD_CMD "ubus -t 30 call network reload"
+
+extern char **environ;
+
+/* Ask netifd to reload configuration of changed interfaces.
+ * netifd compares committed UCI configuration with the running one and
+ * reconfigures only interfaces whose sections differ, others keep
+ * running. Reload is started in background, shell exits right away and
+ * is reaped here.
+ */
+static int
+reload_network(void)
+{
+    char *argv[] = { "/bin/sh", "-c", NETWORK_RELOAD_CMD " >/dev/null 2>&1 &", NULL };
+    pid_t pid;
+    int status = 0;
+    int rc;
+
+    rc = posix_spawn(&pid, argv[0], NULL, NULL, argv, environ);
+    if (rc) {
+        ERR("Could not start network reload: %s", strerror(rc));
+        return -1;
+    }
+
+    while (waitpid(pid, &status, 0) < 0) {
+        if (EINTR != errno) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+struct persist_job *
+persist_job_new(struct change_set *set, bool reload)
+{
+    struct persist_job *job;
+    struct persist_entry *entry;
+    struct if_change *change;
+
+    job = calloc(1, sizeof(*job));
+    if (!job) {
+        return NULL;
+    }
+    INIT_LIST_HEAD(&job->entries);
+    job->reload = reload;
+    job->interfaces = set->count;
+
+    change_set_for_each(change, set) {
+        if (!change->section) {
+            WRN("No UCI section for interface %s", change->name);
+            continue;
+        }
+
+        entry = calloc(1, sizeof(*entry));
+        if (!entry) {
+            goto error;
+        }
+        entry->section = strdup(change->section);
+        if (!entry->section) {
+            free(entry);
+            goto error;
+        }
+
+        entry->leaves = change->leaves;
+        entry->enabled = change->config.enabled;
+        entry->origin = change->config.origin;
+        entry->mtu = change->config.mtu;
+        entry->enabled6 = change->config.ipv6.enabled;
+        entry->mtu6 = change->config.ipv6.mtu;
+        entry->dad_transmits = change->config.ipv6.dad_transmits;
+        address_list_init(&entry->addresses);
+        address_list_init(&entry->added);
+        address_list_init(&entry->removed);
+        address_list_init(&entry->addresses6);
+        address_list_init(&entry->added6);
+        address_list_init(&entry->removed6);
+        list_add_tail(&entry->head, &job->entries);
+
+        if ((change->leaves & CHANGE_ADDRESS) &&
+            (address_list_copy(&entry->addresses, &change->config.addresses) ||
+             change_address_diff(change, AF_INET, &entry->added, &entry->removed))) {
+            goto error;
+        }
+        if ((change->leaves & CHANGE_IPV6_ADDRESS) &&
+            (address_list_copy(&entry->addresses6, &change->config.ipv6.addresses) ||
+             change_address_diff(change, AF_INET6, &entry->added6, &entry->removed6))) {
+            goto error;
+        }
+    }
+
+    return job;
+
+  error:
+    persist_job_free(job);
+    return NULL;
+}
+
+void
+persist_job_free(struct persist_job *job)
+{
+    struct persist_entry *entry, *tmp;
+
+    if (!job) {
+        return;
+    }
+
+    list_for_each_entry_safe(entry, tmp, &job->entries, head) {
+        list_del(&entry->head);
+        free(entry->section);
+        address_list_free(&entry->addresses);
+        address_list_free(&entry->added);
+        address_list_free(&entry->removed);
+        address_list_free(&entry->addresses6);
+        address_list_free(&entry->added6);
+        address_list_free(&entry->removed6);
+        free(entry);
+    }
+    free(job);
+}
+
+/* Only options in UCI can be changed, and only for leaves in job. */
+static void
+persist_stage(struct uci_batch *batch, struct persist_job *job)
+{
+    struct persist_entry *entry;
+
+    list_for_each_entry(entry, &job->entries, head) {
+        /* enabled */
+        if (entry->leaves & CHANGE_ENABLED) {
+            set_operstate(batch, entry->section, entry->enabled);
+        }
+
+        /* forwarding */
+        /* set_forwarding(link, iface->proto.ipv4->forwarding); */
+
+        /* origin */
+        if (entry->leaves & CHANGE_ORIGIN) {
+            set_origin(batch, entry->section, origin_to_string(entry->origin));
+        }
+
+        /* MTU */
+        if (entry->leaves & CHANGE_MTU) {
+            set_mtu(batch, entry->section, entry->mtu);
+        }
+
+        /* addresses with prefix length */
+        if (entry->leaves & CHANGE_ADDRESS) {
+            set_ip4_addresses(batch, entry->section, &entry->addresses, &entry->added, &entry->removed);
+        }
+
+        /* IPv6, forwarding and autoconf are not part of UCI model */
+        if (entry->leaves & CHANGE_IPV6_ENABLED) {
+            set_ipv6_enabled(batch, entry->section, entry->enabled6);
+        }
+        if (entry->leaves & CHANGE_IPV6_MTU) {
+            set_mtu6(batch, entry->section, entry->mtu6);
+        }
+        if (entry->leaves & CHANGE_IPV6_DAD) {
+            set_dad_transmits(batch, entry->section, entry->dad_transmits);
+        }
+        if (entry->leaves & CHANGE_IPV6_ADDRESS) {
+            set_ip6_addresses(batch, entry->section, &entry->addresses6, &entry->added6, &entry->removed6);
+        }
+
+        /* TODO neighbor */
+    }
+}
+
+/* Write all jobs by one commit. */
+static void
+persist_write(struct persist *persist, struct list_head *jobs)
+{
+    struct uci_batch batch;
+    struct persist_job *job, *tmp;
+    bool reload = false;
+    int result = -1;
+    int rc = UCI_OK;
+
+    rc = uci_batch_begin(&batch, persist->uctx);
+    UCI_CHECK_RET(rc, exit, "uci batch begin %d", rc);
+
+    list_for_each_entry(job, jobs, head) {
+        persist_stage(&batch, job);
+        reload = reload || job->reload;
+    }
+
+    rc = uci_batch_commit(&batch);
+    UCI_CHECK_RET(rc, exit, "uci batch commit %d", rc);
+
+    /* Leaves kernel did not take are applied by netifd. */
+    result = reload ? reload_network() : 0;
+
+  exit:
+    list_for_each_entry_safe(job, tmp, jobs, head) {
+        list_del(&job->head);
+        if (persist->done) {
+            persist->done(job, result, persist->arg);
+        }
+        persist_job_free(job);
+    }
+}
+
+static void *
+persist_thread(void *arg)
+{
+    struct persist *persist = arg;
+    struct list_head jobs;
+
+    pthread_mutex_lock(&persist->lock);
+    for (;;) {
+        while (!persist->stop && list_empty(&persist->jobs)) {
+            pthread_cond_wait(&persist->cond, &persist->lock);
+        }
+        if (list_empty(&persist->jobs)) {
+            break;
+        }
+
+        /* Take all queued jobs, new ones queue up during commit. */
+        INIT_LIST_HEAD(&jobs);
+        list_splice_init(&persist->jobs, &jobs);
+        pthread_mutex_unlock(&persist->lock);
+
+        persist_write(persist, &jobs);
+
+        pthread_mutex_lock(&persist->lock);
+    }
+    pthread_mutex_unlock(&persist->lock);
+
+    return NULL;
+}
+
+int
+persist_init(struct persist *persist, persist_done_cb done, void *arg)
+{
+    int rc;
+
+    memset(persist, 0, sizeof(*persist));
+    INIT_LIST_HEAD(&persist->jobs);
+    persist->done = done;
+    persist->arg = arg;
+
+    /* UCI context is not shared with sysrepo callbacks. */
+    persist->uctx = uci_alloc_context();
+    if (!persist->uctx) {
+        return -1;
+    }
+
+    pthread_mutex_init(&persist->lock, NULL);
+    pthread_cond_init(&persist->cond, NULL);
+
+    rc = pthread_create(&persist->thread, NULL, persist_thread, persist);
+    if (rc) {
+        ERR("Can't start UCI writer: %s", strerror(rc));
+        pthread_cond_destroy(&persist->cond);
+        pthread_mutex_destroy(&persist->lock);
+        uci_free_context(persist->uctx);
+        persist->uctx = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+persist_cleanup(struct persist *persist)
+{
+    pthread_mutex_lock(&persist->lock);
+    persist->stop = true;
+    pthread_cond_signal(&persist->cond);
+    pthread_mutex_unlock(&persist->lock);
+
+    pthread_join(persist->thread, NULL);
+
+    pthread_cond_destroy(&persist->cond);
+    pthread_mutex_destroy(&persist->lock);
+    uci_free_context(persist->uctx);
+}
+
+void
+persist_submit(struct persist *persist, struct persist_job *job)
+{
+    pthread_mutex_lock(&persist->lock);
+    list_add_tail(&job->head, &persist->jobs);
+    pthread_cond_signal(&persist->cond);
+    pthread_mutex_unlock(&persist->lock);
+}
@@ -0,0 +1,89 @@
+#ifndef __PERSIST_H__
+#define __PERSIST_H__
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <libubox/list.h>
+
+#include "network.h"
+#include "changes.h"
+
+/* Values of one interface to write to its UCI section. */
+struct persist_entry {
+    struct list_head head;
+    char *section;
+    unsigned int leaves;            /* CHANGE_* flags to write */
+    bool enabled;
+    ip_addr_origin origin;
+    uint16_t mtu;
+    struct address_list addresses;  /* all addresses after change */
+    struct address_list added;      /* delta written to existing list */
+    struct address_list removed;
+    bool enabled6;
+    uint32_t mtu6;
+    uint32_t dad_transmits;
+    struct address_list addresses6;
+    struct address_list added6;
+    struct address_list removed6;
+};
+
+/* Changes of one change set, written after they are applied. */
+struct persist_job {
+    struct list_head head;
+    struct list_head entries;
+    bool reload;                    /* some leaves were not applied to kernel */
+    uint64_t id;                    /* set by caller, handed back on completion */
+    size_t interfaces;              /* interfaces in change set */
+};
+
+/**
+ * @brief Called from writer thread once job is written.
+ *
+ * @param[in] rc 0 if configuration was committed and reload (if needed)
+ * was started, -1 otherwise.
+ */
+typedef void (*persist_done_cb)(const struct persist_job *job, int rc, void *arg);
+
+/**
+ * Background writer of UCI configuration.
+ *
+ * Jobs queued while a commit is running are written by the next single
+ * commit, followed by one netifd reload if any of them needs it.
+ */
+struct persist {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct list_head jobs;
+    bool stop;
+    struct uci_context *uctx;       /* used only by writer thread */
+    persist_done_cb done;
+    void *arg;
+};
+
+int persist_init(struct persist *persist, persist_done_cb done, void *arg);
+
+/**
+ * @brief Write queued jobs and stop writer thread.
+ */
+void persist_cleanup(struct persist *persist);
+
+/**
+ * @brief Create job with values of changed interfaces.
+ *
+ * Values are copied, change set can be modified after job is created.
+ * Interfaces without UCI section are skipped, they still count in
+ * interfaces of job.
+ *
+ * @return New job or NULL on allocation failure.
+ */
+struct persist_job *persist_job_new(struct change_set *set, bool reload);
+
+void persist_job_free(struct persist_job *job);
+
+/**
+ * @brief Queue job for writer thread, persist takes ownership of job.
+ */
+void persist_submit(struct persist *persist, struct persist_job *job);
+
+#endif /* __PERSIST_H__ */
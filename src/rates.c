@@ -0,0 +1,345 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "rates.h"
+#include "common.h"
+
+#define NSEC_PER_SEC 1000000000L
+#define NSEC_PER_MSEC 1000000L
+
+static void
+timespec_add_ms(struct timespec *ts, unsigned int ms)
+{
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long) (ms % 1000) * NSEC_PER_MSEC;
+    if (ts->tv_nsec >= NSEC_PER_SEC) {
+        ts->tv_sec++;
+        ts->tv_nsec -= NSEC_PER_SEC;
+    }
+}
+
+static double
+timespec_diff(const struct timespec *a, const struct timespec *b)
+{
+    return (double) (a->tv_sec - b->tv_sec) + (double) (a->tv_nsec - b->tv_nsec) / NSEC_PER_SEC;
+}
+
+static int
+series_cmp(const void *a, const void *b)
+{
+    const struct rate_series *sa = a, *sb = b;
+
+    return (sa->ifindex > sb->ifindex) - (sa->ifindex < sb->ifindex);
+}
+
+static struct rate_series *
+series_find(struct rates *rates, size_t sorted, int ifindex)
+{
+    struct rate_series key = { .ifindex = ifindex };
+
+    return bsearch(&key, rates->series, sorted, sizeof(*rates->series), series_cmp);
+}
+
+static uint64_t
+stats_in_pkts(const struct if_stats *stats)
+{
+    return stats->in_unicast_pkts + stats->in_multicast_pkts;
+}
+
+static void
+series_baseline(struct rate_series *series, const struct if_stats *stats,
+                const struct timespec *now)
+{
+    series->in_octets = stats->in_octets;
+    series->out_octets = stats->out_octets;
+    series->in_pkts = stats_in_pkts(stats);
+    series->out_pkts = stats->out_unicast_pkts;
+    series->stamp = *now;
+}
+
+static void
+series_update(struct rate_series *series, const struct if_stats *stats,
+              const struct timespec *now)
+{
+    uint64_t in_pkts = stats_in_pkts(stats);
+    struct rate_sample *sample;
+    double seconds = timespec_diff(now, &series->stamp);
+    double values[4];
+
+    /* Counters are kept monotonic by continuity, this only guards clock
+     * steps and interfaces whose history could not be allocated. */
+    if (seconds <= 0 ||
+        stats->in_octets < series->in_octets || stats->out_octets < series->out_octets ||
+        in_pkts < series->in_pkts || stats->out_unicast_pkts < series->out_pkts) {
+        series_baseline(series, stats, now);
+        return;
+    }
+
+    values[0] = (double) (stats->in_octets - series->in_octets) * 8 / seconds;
+    values[1] = (double) (stats->out_octets - series->out_octets) * 8 / seconds;
+    values[2] = (double) (in_pkts - series->in_pkts) / seconds;
+    values[3] = (double) (stats->out_unicast_pkts - series->out_pkts) / seconds;
+
+    sample = &series->ring[series->head];
+    sample->in_bps = (uint64_t) (values[0] + 0.5);
+    sample->out_bps = (uint64_t) (values[1] + 0.5);
+    sample->in_pps = (uint64_t) (values[2] + 0.5);
+    sample->out_pps = (uint64_t) (values[3] + 0.5);
+    series->head = (series->head + 1) % RATES_WINDOW;
+
+    for (int i = 0; i < 4; i++) {
+        if (series->count) {
+            series->average[i] += RATES_EWMA_WEIGHT * (values[i] - series->average[i]);
+        } else {
+            series->average[i] = values[i];
+        }
+    }
+    if (series->count < RATES_WINDOW) {
+        series->count++;
+    }
+
+    series_baseline(series, stats, now);
+}
+
+/* Merge one dump into series, links missing from dump are dropped. */
+static void
+rates_merge(struct rates *rates, const struct stats_table *table, const struct timespec *now)
+{
+    struct rate_series *series;
+    size_t sorted = rates->count;
+    size_t kept = 0;
+    size_t size;
+    bool *seen;
+
+    seen = calloc(sorted ? sorted : 1, sizeof(*seen));
+    if (!seen) {
+        return;
+    }
+
+    for (size_t i = 0; i < table->count; i++) {
+        const struct if_stats *stats = &table->entries[i];
+
+        series = series_find(rates, sorted, stats->ifindex);
+        if (series) {
+            seen[series - rates->series] = true;
+            series_update(series, stats, now);
+            continue;
+        }
+
+        /* New links are appended and sorted in below. */
+        if (rates->count == rates->size) {
+            size = rates->size ? rates->size * 2 : 16;
+            series = realloc(rates->series, size * sizeof(*series));
+            if (!series) {
+                continue;
+            }
+            rates->series = series;
+            rates->size = size;
+        }
+        series = &rates->series[rates->count++];
+        memset(series, 0, sizeof(*series));
+        series->ifindex = stats->ifindex;
+        series_baseline(series, stats, now);
+    }
+
+    for (size_t i = 0; i < rates->count; i++) {
+        if (i < sorted && !seen[i]) {
+            continue;
+        }
+        if (kept != i) {
+            rates->series[kept] = rates->series[i];
+        }
+        kept++;
+    }
+    free(seen);
+
+    if (kept != sorted || rates->count != sorted) {
+        rates->count = kept;
+        qsort(rates->series, rates->count, sizeof(*rates->series), series_cmp);
+    }
+}
+
+static void *
+rates_thread(void *arg)
+{
+    struct rates *rates = arg;
+    struct timespec now, deadline;
+    int rc;
+
+    pthread_mutex_lock(&rates->lock);
+
+    while (!rates->stop) {
+        if (!rates->interval) {
+            pthread_cond_wait(&rates->cond, &rates->lock);
+            continue;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        timespec_add_ms(&deadline, rates->interval);
+
+        /* Dump runs unlocked, readers are only blocked by merge. */
+        pthread_mutex_unlock(&rates->lock);
+        rc = stats_continuity_collect(rates->continuity, rates->socket, NULL, &rates->stats);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        pthread_mutex_lock(&rates->lock);
+
+        if (rc < 0) {
+            WRN("rate sampler link dump failed (%s)", nl_geterror(rc));
+        } else if (rates->interval) {
+            rates_merge(rates, &rates->stats, &now);
+            rates->rounds++;
+        }
+
+        while (!rates->stop && rates->interval) {
+            rc = pthread_cond_timedwait(&rates->cond, &rates->lock, &deadline);
+            if (ETIMEDOUT == rc) {
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&rates->lock);
+
+    return NULL;
+}
+
+int
+rates_init(struct rates *rates, struct stats_continuity *continuity)
+{
+    pthread_condattr_t attr;
+    int rc;
+
+    memset(rates, 0, sizeof(*rates));
+    rates->interval = RATES_INTERVAL_DEFAULT;
+    rates->continuity = continuity;
+
+    rates->socket = nl_socket_alloc();
+    if (!rates->socket) {
+        return -1;
+    }
+
+    rc = nl_connect(rates->socket, NETLINK_ROUTE);
+    if (rc < 0) {
+        ERR("unable to connect rate sampler socket (%s)", nl_geterror(rc));
+        goto error;
+    }
+
+    if (pthread_mutex_init(&rates->lock, NULL)) {
+        goto error;
+    }
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    rc = pthread_cond_init(&rates->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (rc) {
+        pthread_mutex_destroy(&rates->lock);
+        goto error;
+    }
+
+    rc = pthread_create(&rates->thread, NULL, rates_thread, rates);
+    if (rc) {
+        ERR("Can't start rate sampler: %s", strerror(rc));
+        pthread_cond_destroy(&rates->cond);
+        pthread_mutex_destroy(&rates->lock);
+        goto error;
+    }
+
+    return 0;
+
+  error:
+    nl_socket_free(rates->socket);
+    rates->socket = NULL;
+    return -1;
+}
+
+void
+rates_cleanup(struct rates *rates)
+{
+    pthread_mutex_lock(&rates->lock);
+    rates->stop = true;
+    pthread_cond_signal(&rates->cond);
+    pthread_mutex_unlock(&rates->lock);
+
+    pthread_join(rates->thread, NULL);
+
+    free(rates->series);
+    stats_table_free(&rates->stats);
+    nl_socket_free(rates->socket);
+    pthread_cond_destroy(&rates->cond);
+    pthread_mutex_destroy(&rates->lock);
+}
+
+void
+rates_set_interval(struct rates *rates, unsigned int interval)
+{
+    if (interval && interval < RATES_INTERVAL_MIN) {
+        interval = RATES_INTERVAL_MIN;
+    } else if (interval > RATES_INTERVAL_MAX) {
+        interval = RATES_INTERVAL_MAX;
+    }
+
+    pthread_mutex_lock(&rates->lock);
+    if (rates->interval != interval) {
+        /* Samples of different intervals are not mixed. */
+        rates->count = 0;
+        rates->interval = interval;
+        pthread_cond_signal(&rates->cond);
+    }
+    pthread_mutex_unlock(&rates->lock);
+}
+
+int
+rates_get(struct rates *rates, int ifindex, struct rate_info *info)
+{
+    struct rate_series *series;
+    int rc = -1;
+
+    pthread_mutex_lock(&rates->lock);
+
+    series = series_find(rates, rates->count, ifindex);
+    if (!series || !series->count) {
+        goto exit;
+    }
+
+    memset(info, 0, sizeof(*info));
+    info->last = series->ring[(series->head + RATES_WINDOW - 1) % RATES_WINDOW];
+    info->samples = series->count;
+    info->average.in_bps = (uint64_t) (series->average[0] + 0.5);
+    info->average.out_bps = (uint64_t) (series->average[1] + 0.5);
+    info->average.in_pps = (uint64_t) (series->average[2] + 0.5);
+    info->average.out_pps = (uint64_t) (series->average[3] + 0.5);
+
+    /* Ring is only ever filled from start, first count slots are valid. */
+    for (size_t i = 0; i < series->count; i++) {
+        const struct rate_sample *sample = &series->ring[i];
+
+        if (sample->in_bps > info->peak.in_bps) {
+            info->peak.in_bps = sample->in_bps;
+        }
+        if (sample->out_bps > info->peak.out_bps) {
+            info->peak.out_bps = sample->out_bps;
+        }
+        if (sample->in_pps > info->peak.in_pps) {
+            info->peak.in_pps = sample->in_pps;
+        }
+        if (sample->out_pps > info->peak.out_pps) {
+            info->peak.out_pps = sample->out_pps;
+        }
+    }
+    rc = 0;
+
+  exit:
+    pthread_mutex_unlock(&rates->lock);
+    return rc;
+}
+
+void
+rates_counters(struct rates *rates, unsigned int *interval, uint64_t *rounds)
+{
+    pthread_mutex_lock(&rates->lock);
+    *interval = rates->interval;
+    *rounds = rates->rounds;
+    pthread_mutex_unlock(&rates->lock);
+}
@@ -0,0 +1,99 @@
+#ifndef __RATES_H__
+#define __RATES_H__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <libnl3/netlink/netlink.h>
+
+#include "stats.h"
+
+#define RATES_INTERVAL_DEFAULT 1000     /* milliseconds */
+#define RATES_INTERVAL_MIN 100
+#define RATES_INTERVAL_MAX 60000
+#define RATES_WINDOW 64                 /* samples kept per interface, peaks are taken over them */
+#define RATES_EWMA_WEIGHT 0.125         /* weight of newest sample in averages */
+
+/* Rates of one interval. */
+struct rate_sample {
+    uint64_t in_bps;
+    uint64_t out_bps;
+    uint64_t in_pps;
+    uint64_t out_pps;
+};
+
+/* Rates served for one interface. */
+struct rate_info {
+    struct rate_sample last;        /* rates of last interval */
+    struct rate_sample average;     /* exponentially weighted moving average */
+    struct rate_sample peak;        /* maximum over window */
+    size_t samples;                 /* intervals in window */
+};
+
+/* Ring of samples and averages of one interface. */
+struct rate_series {
+    int ifindex;
+    uint64_t in_octets;             /* counters at last sample */
+    uint64_t out_octets;
+    uint64_t in_pkts;
+    uint64_t out_pkts;
+    struct timespec stamp;          /* CLOCK_MONOTONIC of last sample */
+    struct rate_sample ring[RATES_WINDOW];
+    size_t head;                    /* next slot to write */
+    size_t count;
+    double average[4];              /* in_bps, out_bps, in_pps, out_pps */
+};
+
+/**
+ * Counter rate engine.
+ *
+ * Sampler thread dumps 64-bit link counters of all interfaces once per
+ * interval on its own socket, so it never waits for operational data
+ * requests or other netlink users. Series are kept sorted by ifindex.
+ */
+struct rates {
+    pthread_t thread;
+    pthread_mutex_t lock;           /* protects everything below */
+    pthread_cond_t cond;
+    bool stop;
+    unsigned int interval;          /* ms, 0 disables sampling */
+    uint64_t rounds;                /* dumps done */
+    struct nl_sock *socket;
+    struct stats_continuity *continuity;
+    struct stats_table stats;       /* reused between dumps */
+    struct rate_series *series;
+    size_t count;
+    size_t size;
+};
+
+/**
+ * @brief Start sampler thread.
+ *
+ * @param[in] continuity Counter continuity dumps are passed through, resets
+ * found by sampler are then also seen by statistics requests.
+ * @return 0 on success, -1 otherwise.
+ */
+int rates_init(struct rates *rates, struct stats_continuity *continuity);
+
+/**
+ * @brief Stop sampler thread and free all series.
+ */
+void rates_cleanup(struct rates *rates);
+
+/**
+ * @brief Set sampling interval in milliseconds, 0 stops sampling and drops history.
+ */
+void rates_set_interval(struct rates *rates, unsigned int interval);
+
+/**
+ * @brief Get rates of interface.
+ *
+ * @return 0 on success, -1 if interface has no complete interval yet.
+ */
+int rates_get(struct rates *rates, int ifindex, struct rate_info *info);
+
+void rates_counters(struct rates *rates, unsigned int *interval, uint64_t *rounds);
+
+#endif /* __RATES_H__ */
@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "registry.h"
+
+/* FNV-1a, interface names are short. */
+static size_t
+name_hash(const char *name)
+{
+    size_t hash = 2166136261u;
+
+    while (*name) {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static struct list_head *
+name_bucket(struct if_registry *reg, const char *name)
+{
+    return &reg->by_name[name_hash(name) & (reg->buckets - 1)];
+}
+
+static struct list_head *
+index_bucket(struct if_registry *reg, int ifindex)
+{
+    return &reg->by_index[(size_t) ifindex & (reg->buckets - 1)];
+}
+
+static struct list_head *
+buckets_alloc(size_t count)
+{
+    struct list_head *buckets = malloc(count * sizeof(*buckets));
+
+    if (!buckets) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        INIT_LIST_HEAD(&buckets[i]);
+    }
+
+    return buckets;
+}
+
+/* Double number of buckets, on allocation failure registry keeps working
+ * with longer chains. */
+static void
+registry_grow(struct if_registry *reg)
+{
+    struct list_head *by_name, *by_index;
+    struct if_interface *iface;
+
+    by_name = buckets_alloc(reg->buckets * 2);
+    by_index = buckets_alloc(reg->buckets * 2);
+    if (!by_name || !by_index) {
+        free(by_name);
+        free(by_index);
+        return;
+    }
+
+    free(reg->by_name);
+    free(reg->by_index);
+    reg->by_name = by_name;
+    reg->by_index = by_index;
+    reg->buckets *= 2;
+
+    registry_for_each(iface, reg) {
+        list_add(&iface->name_node, name_bucket(reg, iface->name));
+        list_add(&iface->index_node, index_bucket(reg, iface->ifindex));
+    }
+}
+
+struct if_registry *
+registry_new(void)
+{
+    struct if_registry *reg;
+
+    reg = calloc(1, sizeof(*reg));
+    if (!reg) {
+        return NULL;
+    }
+
+    INIT_LIST_HEAD(&reg->interfaces);
+    reg->buckets = REGISTRY_INIT_BUCKETS;
+    reg->by_name = buckets_alloc(reg->buckets);
+    reg->by_index = buckets_alloc(reg->buckets);
+    if (!reg->by_name || !reg->by_index) {
+        registry_free(reg, NULL);
+        return NULL;
+    }
+
+    return reg;
+}
+
+void
+registry_free(struct if_registry *reg, void (*free_fn)(struct if_interface *))
+{
+    struct if_interface *iface, *tmp;
+
+    if (!reg) {
+        return;
+    }
+
+    if (reg->by_name && reg->by_index) {
+        registry_for_each_safe(iface, tmp, reg) {
+            registry_remove(reg, iface);
+            if (free_fn) {
+                free_fn(iface);
+            }
+        }
+    }
+
+    free(reg->by_name);
+    free(reg->by_index);
+    free(reg);
+}
+
+int
+registry_add(struct if_registry *reg, struct if_interface *iface)
+{
+    if (reg->count >= reg->buckets * REGISTRY_MAX_LOAD) {
+        registry_grow(reg);
+    }
+
+    list_add_tail(&iface->head, &reg->interfaces);
+    list_add(&iface->name_node, name_bucket(reg, iface->name));
+    list_add(&iface->index_node, index_bucket(reg, iface->ifindex));
+    reg->count++;
+
+    return 0;
+}
+
+void
+registry_remove(struct if_registry *reg, struct if_interface *iface)
+{
+    list_del(&iface->head);
+    list_del(&iface->name_node);
+    list_del(&iface->index_node);
+    reg->count--;
+}
+
+int
+registry_rename(struct if_registry *reg, struct if_interface *iface, const char *name)
+{
+    char *new_name = strdup(name);
+
+    if (!new_name) {
+        return -1;
+    }
+
+    list_del(&iface->name_node);
+    free(iface->name);
+    iface->name = new_name;
+    list_add(&iface->name_node, name_bucket(reg, iface->name));
+
+    return 0;
+}
+
+struct if_interface *
+registry_find_name(struct if_registry *reg, const char *name)
+{
+    struct if_interface *iface;
+    struct list_head *bucket = name_bucket(reg, name);
+
+    list_for_each_entry(iface, bucket, name_node) {
+        if (!strcmp(iface->name, name)) {
+            return iface;
+        }
+    }
+
+    return NULL;
+}
+
+struct if_interface *
+registry_find_index(struct if_registry *reg, int ifindex)
+{
+    struct if_interface *iface;
+    struct list_head *bucket = index_bucket(reg, ifindex);
+
+    list_for_each_entry(iface, bucket, index_node) {
+        if (iface->ifindex == ifindex) {
+            return iface;
+        }
+    }
+
+    return NULL;
+}
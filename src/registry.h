@@ -0,0 +1,61 @@
+#ifndef __REGISTRY_H__
+#define __REGISTRY_H__
+
+#include <stddef.h>
+#include <libubox/list.h>
+
+#include "network.h"
+
+#define REGISTRY_INIT_BUCKETS 64
+#define REGISTRY_MAX_LOAD 2         /* average entries per bucket before growing */
+
+/**
+ * Interfaces known to the plugin, indexed by name and by ifindex.
+ *
+ * Entries are never moved, pointer to if_interface is a stable handle
+ * until the interface is removed from registry.
+ */
+struct if_registry {
+    struct list_head interfaces;    /* all entries for full walks */
+    struct list_head *by_name;
+    struct list_head *by_index;
+    size_t buckets;
+    size_t count;
+};
+
+#define registry_for_each(IFACE, REG) \
+    list_for_each_entry(IFACE, &(REG)->interfaces, head)
+
+#define registry_for_each_safe(IFACE, TMP, REG) \
+    list_for_each_entry_safe(IFACE, TMP, &(REG)->interfaces, head)
+
+struct if_registry *registry_new(void);
+
+/**
+ * @brief Free registry, interfaces still in it are released with free_fn.
+ */
+void registry_free(struct if_registry *reg, void (*free_fn)(struct if_interface *));
+
+/**
+ * @brief Add interface to registry, its name and ifindex must be set.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int registry_add(struct if_registry *reg, struct if_interface *iface);
+
+/**
+ * @brief Remove interface from registry, caller owns it afterwards.
+ */
+void registry_remove(struct if_registry *reg, struct if_interface *iface);
+
+/**
+ * @brief Change name of interface in registry.
+ *
+ * @return 0 on success, -1 on allocation failure (old name is kept).
+ */
+int registry_rename(struct if_registry *reg, struct if_interface *iface, const char *name);
+
+struct if_interface *registry_find_name(struct if_registry *reg, const char *name);
+struct if_interface *registry_find_index(struct if_registry *reg, int ifindex);
+
+#endif /* __REGISTRY_H__ */
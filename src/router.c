@@ -0,0 +1,369 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+
+#include <libnl3/netlink/msg.h>
+#include <libnl3/netlink/cache.h>
+#include <libnl3/netlink/route/rtnl.h>
+#include <libnl3/netlink/route/route.h>
+
+#include "router.h"
+#include "common.h"
+
+#define ROUTER_TABLE_INIT_SIZE 4       /* routers per interface */
+
+/* Route notification being parsed. */
+struct route_event {
+    struct router_table *rt;
+    bool add;
+};
+
+static struct list_head *
+if_bucket(struct router_table *rt, int ifindex)
+{
+    return &rt->ifaces[(size_t) ifindex & (ROUTER_TABLE_BUCKETS - 1)];
+}
+
+static struct if_routers *
+if_routers_find(struct router_table *rt, int ifindex)
+{
+    struct if_routers *ifr;
+
+    list_for_each_entry(ifr, if_bucket(rt, ifindex), node) {
+        if (ifr->ifindex == ifindex) {
+            return ifr;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+if_routers_free(struct if_routers *ifr)
+{
+    list_del(&ifr->node);
+    free(ifr->entries);
+    free(ifr);
+}
+
+/* Routers of one interface are few, linear search is enough. */
+static struct router_entry *
+router_find(struct if_routers *ifr, const void *addr)
+{
+    for (size_t i = 0; i < ifr->count; i++) {
+        if (!memcmp(&ifr->entries[i].addr, addr, sizeof(ifr->entries[i].addr))) {
+            return &ifr->entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Set or clear one source of router, entry is dropped with its last source
+ * and interface with its last router. */
+static int
+router_set(struct router_table *rt, int ifindex, const void *addr, unsigned int source, bool set)
+{
+    struct if_routers *ifr = if_routers_find(rt, ifindex);
+    struct router_entry *entry = ifr ? router_find(ifr, addr) : NULL;
+    struct router_entry *entries;
+    size_t size;
+
+    if (!set) {
+        if (entry) {
+            entry->sources &= ~source;
+            if (!entry->sources) {
+                *entry = ifr->entries[--ifr->count];
+            }
+            if (!ifr->count) {
+                if_routers_free(ifr);
+            }
+        }
+        return 0;
+    }
+
+    if (!ifr) {
+        ifr = calloc(1, sizeof(*ifr));
+        if (!ifr) {
+            return -1;
+        }
+        ifr->ifindex = ifindex;
+        list_add(&ifr->node, if_bucket(rt, ifindex));
+    }
+
+    if (!entry) {
+        if (ifr->count == ifr->size) {
+            size = ifr->size ? ifr->size * 2 : ROUTER_TABLE_INIT_SIZE;
+            entries = realloc(ifr->entries, size * sizeof(*entries));
+            if (!entries) {
+                if (!ifr->count) {
+                    if_routers_free(ifr);
+                }
+                return -1;
+            }
+            ifr->entries = entries;
+            ifr->size = size;
+        }
+        entry = &ifr->entries[ifr->count++];
+        memcpy(&entry->addr, addr, sizeof(entry->addr));
+        entry->sources = 0;
+    }
+    entry->sources |= source;
+
+    return 0;
+}
+
+/* Clear source from all entries. */
+static void
+router_clear(struct router_table *rt, unsigned int source)
+{
+    struct if_routers *ifr, *tmp;
+    size_t i;
+
+    for (size_t b = 0; b < ROUTER_TABLE_BUCKETS; b++) {
+        list_for_each_entry_safe(ifr, tmp, &rt->ifaces[b], node) {
+            i = 0;
+            while (i < ifr->count) {
+                ifr->entries[i].sources &= ~source;
+                if (!ifr->entries[i].sources) {
+                    ifr->entries[i] = ifr->entries[--ifr->count];
+                } else {
+                    i++;
+                }
+            }
+            if (!ifr->count) {
+                if_routers_free(ifr);
+            }
+        }
+    }
+}
+
+static void
+nexthop_cb(struct rtnl_nexthop *nh, void *arg)
+{
+    struct route_event *ev = arg;
+    struct nl_addr *gw = rtnl_route_nh_get_gateway(nh);
+
+    if (!gw || AF_INET6 != nl_addr_get_family(gw)) {
+        return;
+    }
+
+    if (router_set(ev->rt, rtnl_route_nh_get_ifindex(nh), nl_addr_get_binary_addr(gw),
+                   ROUTER_SRC_RA, ev->add)) {
+        ERR_MSG("unable to track router, out of memory");
+    }
+}
+
+/* Only default routes installed from router advertisements are of interest. */
+static void
+route_parse_cb(struct nl_object *obj, void *arg)
+{
+    struct rtnl_route *route = (struct rtnl_route *) obj;
+    struct nl_addr *dst = rtnl_route_get_dst(route);
+
+    if (AF_INET6 != rtnl_route_get_family(route) ||
+        RTPROT_RA != rtnl_route_get_protocol(route) ||
+        (dst && nl_addr_get_prefixlen(dst))) {
+        return;
+    }
+
+    rtnl_route_foreach_nexthop(route, nexthop_cb, arg);
+}
+
+static int
+route_msg_cb(struct nl_msg *msg, void *arg)
+{
+    struct route_event ev = { .rt = arg };
+    int type = nlmsg_hdr(msg)->nlmsg_type;
+
+    if (RTM_NEWROUTE != type && RTM_DELROUTE != type) {
+        return NL_OK;
+    }
+
+    ev.add = RTM_NEWROUTE == type;
+    nl_msg_parse(msg, route_parse_cb, &ev);
+
+    return NL_OK;
+}
+
+/* Forget RA routers and learn them again from route dump. */
+static int
+router_dump(struct router_table *rt, struct nl_sock *request)
+{
+    int rc;
+
+    router_clear(rt, ROUTER_SRC_RA);
+
+    rc = nl_rtgen_request(request, RTM_GETROUTE, AF_INET6, NLM_F_DUMP);
+    if (rc < 0) {
+        return rc;
+    }
+
+    rc = nl_recvmsgs(request, rt->cb);
+
+    return rc < 0 ? rc : 0;
+}
+
+struct router_table *
+router_table_new(struct nl_sock *request)
+{
+    struct router_table *rt;
+    int rc;
+
+    rt = calloc(1, sizeof(*rt));
+    if (!rt) {
+        return NULL;
+    }
+    for (size_t i = 0; i < ROUTER_TABLE_BUCKETS; i++) {
+        INIT_LIST_HEAD(&rt->ifaces[i]);
+    }
+
+    rt->cb = nl_cb_alloc(NL_CB_DEFAULT);
+    if (!rt->cb) {
+        goto error;
+    }
+    nl_cb_set(rt->cb, NL_CB_VALID, NL_CB_CUSTOM, route_msg_cb, rt);
+
+    rt->socket = nl_socket_alloc();
+    if (!rt->socket) {
+        goto error;
+    }
+
+    /* Notifications are not answers to our requests. */
+    nl_socket_disable_seq_check(rt->socket);
+
+    rc = nl_connect(rt->socket, NETLINK_ROUTE);
+    if (rc < 0) {
+        ERR("unable to connect route event socket (%s)", nl_geterror(rc));
+        goto error;
+    }
+
+    rc = nl_socket_add_membership(rt->socket, RTNLGRP_IPV6_ROUTE);
+    if (rc < 0) {
+        ERR("unable to subscribe to route events (%s)", nl_geterror(rc));
+        goto error;
+    }
+    nl_socket_set_nonblocking(rt->socket);
+
+    /* Subscribed before dump, so no change falls between them. */
+    rc = router_dump(rt, request);
+    if (rc < 0) {
+        ERR("unable to dump routes (%s)", nl_geterror(rc));
+        goto error;
+    }
+
+    return rt;
+
+  error:
+    router_table_free(rt);
+    return NULL;
+}
+
+void
+router_table_free(struct router_table *rt)
+{
+    if (!rt) {
+        return;
+    }
+
+    if (rt->socket) {
+        nl_socket_free(rt->socket);
+    }
+    if (rt->cb) {
+        nl_cb_put(rt->cb);
+    }
+    router_clear(rt, ROUTER_SRC_NEIGH | ROUTER_SRC_RA);
+    free(rt);
+}
+
+int
+router_table_poll(struct router_table *rt, struct nl_sock *request)
+{
+    bool received = false;
+    int rc;
+
+    do {
+        rc = nl_recvmsgs_report(rt->socket, rt->cb);
+        received |= rc > 0;
+    } while (rc > 0);
+
+    /* Nonblocking socket is drained. */
+    if (0 == rc || -NLE_AGAIN == rc) {
+        return received ? 1 : 0;
+    }
+
+    if (-NLE_NOMEM == rc) {
+        /* Socket buffer overrun (ENOBUFS), some notifications are lost. */
+        WRN("route notifications lost (%s), dumping routes", nl_geterror(rc));
+        rc = router_dump(rt, request);
+        return rc < 0 ? rc : 1;
+    }
+
+    return rc;
+}
+
+void
+router_table_neigh(struct router_table *rt, struct rtnl_neigh *neigh, int action)
+{
+    struct nl_addr *dst = rtnl_neigh_get_dst(neigh);
+    bool router;
+
+    if (AF_INET6 != rtnl_neigh_get_family(neigh) || !dst) {
+        return;
+    }
+
+    router = NL_ACT_DEL != action && (rtnl_neigh_get_flags(neigh) & NTF_ROUTER);
+
+    if (router_set(rt, rtnl_neigh_get_ifindex(neigh), nl_addr_get_binary_addr(dst),
+                   ROUTER_SRC_NEIGH, router)) {
+        ERR_MSG("unable to track router, out of memory");
+    }
+}
+
+static void
+rebuild_neigh_cb(struct nl_object *obj, void *arg)
+{
+    router_table_neigh(arg, (struct rtnl_neigh *) obj, NL_ACT_NEW);
+}
+
+void
+router_table_rebuild_neigh(struct router_table *rt, struct nl_cache *cache)
+{
+    router_clear(rt, ROUTER_SRC_NEIGH);
+    nl_cache_foreach(cache, rebuild_neigh_cb, rt);
+}
+
+bool
+router_table_is_router(struct router_table *rt, int ifindex, const struct in6_addr *addr)
+{
+    struct if_routers *ifr = if_routers_find(rt, ifindex);
+
+    return ifr && NULL != router_find(ifr, addr);
+}
+
+struct in6_addr *
+router_table_get(struct router_table *rt, int ifindex, size_t *count)
+{
+    struct if_routers *ifr = if_routers_find(rt, ifindex);
+    struct in6_addr *routers;
+
+    *count = 0;
+
+    if (!ifr) {
+        return NULL;
+    }
+
+    routers = malloc(ifr->count * sizeof(*routers));
+    if (!routers) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < ifr->count; i++) {
+        routers[i] = ifr->entries[i].addr;
+    }
+    *count = ifr->count;
+
+    return routers;
+}
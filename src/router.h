@@ -0,0 +1,88 @@
+#ifndef __ROUTER_H__
+#define __ROUTER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include <libubox/list.h>
+#include <libnl3/netlink/netlink.h>
+#include <libnl3/netlink/route/neighbour.h>
+
+/* Sources telling that neighbor is a router. */
+#define ROUTER_SRC_NEIGH 0x1        /* neighbor entry has NTF_ROUTER flag */
+#define ROUTER_SRC_RA 0x2           /* gateway of default route learned from RA */
+
+#define ROUTER_TABLE_BUCKETS 64     /* interface hash buckets, power of two */
+
+struct router_entry {
+    struct in6_addr addr;
+    unsigned int sources;
+};
+
+/* Routers of one interface, there are one or few of them. */
+struct if_routers {
+    struct list_head node;          /* interface hash chain */
+    int ifindex;
+    struct router_entry *entries;
+    size_t count;
+    size_t size;
+};
+
+/**
+ * IPv6 routers known to kernel, tracked passively.
+ *
+ * Neighbor entries are fed from neighbor cache changes. Default routes
+ * learned from router advertisements come from RTNLGRP_IPV6_ROUTE
+ * notifications, which are parsed as they arrive so that no route cache
+ * is kept. Nothing is sent on the wire. Routers are kept per interface,
+ * hashed by ifindex like neighbor index, so lookups only see routers of
+ * the interface asked for.
+ */
+struct router_table {
+    struct list_head ifaces[ROUTER_TABLE_BUCKETS];
+    struct nl_sock *socket;         /* RTNLGRP_IPV6_ROUTE notifications */
+    struct nl_cb *cb;
+};
+
+/**
+ * @brief Subscribe to route notifications and dump current RA routes.
+ *
+ * @param[in] request Socket used for route dump.
+ * @return New table or NULL on failure.
+ */
+struct router_table *router_table_new(struct nl_sock *request);
+
+void router_table_free(struct router_table *rt);
+
+/**
+ * @brief Apply pending route notifications, does not block.
+ *
+ * If notifications were lost, RA routes are dumped again.
+ *
+ * @param[in] request Socket used for route dump.
+ * @return 0 if nothing was pending, 1 if table may have changed,
+ * negative libnl error otherwise.
+ */
+int router_table_poll(struct router_table *rt, struct nl_sock *request);
+
+/**
+ * @brief Update table from neighbor added, changed or removed (NL_ACT_*).
+ */
+void router_table_neigh(struct router_table *rt, struct rtnl_neigh *neigh, int action);
+
+/**
+ * @brief Replace neighbor entries of table with routers in neighbor cache.
+ */
+void router_table_rebuild_neigh(struct router_table *rt, struct nl_cache *cache);
+
+bool router_table_is_router(struct router_table *rt, int ifindex, const struct in6_addr *addr);
+
+/**
+ * @brief Get routers of interface.
+ *
+ * @param[out] count Number of routers returned.
+ * @return Allocated array to free or NULL if there are none.
+ */
+struct in6_addr *router_table_get(struct router_table *rt, int ifindex, size_t *count);
+
+#endif /* __ROUTER_H__ */
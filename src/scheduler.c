@@ -0,0 +1,185 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "scheduler.h"
+#include "common.h"
+
+static void
+timespec_add_ms(struct timespec *ts, unsigned int ms)
+{
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long) (ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+static bool
+timespec_before(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/* When pending set is due, sched->lock is held. */
+static struct timespec
+scheduler_deadline(struct scheduler *sched)
+{
+    struct timespec quiet = sched->last;
+    struct timespec delay = sched->first;
+
+    timespec_add_ms(&quiet, sched->quiet);
+    timespec_add_ms(&delay, sched->max_delay);
+
+    return timespec_before(&quiet, &delay) ? quiet : delay;
+}
+
+static void *
+scheduler_thread(void *arg)
+{
+    struct scheduler *sched = arg;
+    struct change_set set;
+    struct timespec deadline, now;
+
+    change_set_init(&set);
+
+    pthread_mutex_lock(&sched->lock);
+    for (;;) {
+        if (0 == sched->pending.count) {
+            if (sched->stop) {
+                break;
+            }
+            pthread_cond_wait(&sched->cond, &sched->lock);
+            continue;
+        }
+
+        /* Wait until burst is over, stop flushes right away. */
+        deadline = scheduler_deadline(sched);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (!sched->stop && timespec_before(&now, &deadline)) {
+            pthread_cond_timedwait(&sched->cond, &sched->lock, &deadline);
+            continue;
+        }
+
+        change_set_merge(&set, &sched->pending);
+        sched->applied++;
+        pthread_mutex_unlock(&sched->lock);
+
+        sched->apply(&set, sched->arg);
+        change_set_free(&set);
+
+        pthread_mutex_lock(&sched->lock);
+    }
+    pthread_mutex_unlock(&sched->lock);
+
+    return NULL;
+}
+
+int
+scheduler_init(struct scheduler *sched, scheduler_apply_cb apply, void *arg)
+{
+    pthread_condattr_t attr;
+    int rc;
+
+    memset(sched, 0, sizeof(*sched));
+    change_set_init(&sched->pending);
+    sched->quiet = SCHEDULER_QUIET_DEFAULT;
+    sched->max_delay = SCHEDULER_DELAY_DEFAULT;
+    sched->apply = apply;
+    sched->arg = arg;
+
+    if (pthread_mutex_init(&sched->lock, NULL)) {
+        return -1;
+    }
+
+    /* Deadlines are not affected by wall clock changes. */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    rc = pthread_cond_init(&sched->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (rc) {
+        pthread_mutex_destroy(&sched->lock);
+        return -1;
+    }
+
+    rc = pthread_create(&sched->thread, NULL, scheduler_thread, sched);
+    if (rc) {
+        ERR("Can't start change scheduler: %s", strerror(rc));
+        pthread_cond_destroy(&sched->cond);
+        pthread_mutex_destroy(&sched->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+scheduler_cleanup(struct scheduler *sched)
+{
+    pthread_mutex_lock(&sched->lock);
+    sched->stop = true;
+    pthread_cond_signal(&sched->cond);
+    pthread_mutex_unlock(&sched->lock);
+
+    pthread_join(sched->thread, NULL);
+
+    change_set_free(&sched->pending);
+    pthread_cond_destroy(&sched->cond);
+    pthread_mutex_destroy(&sched->lock);
+}
+
+void
+scheduler_set_times(struct scheduler *sched, unsigned int quiet, unsigned int max_delay)
+{
+    pthread_mutex_lock(&sched->lock);
+    sched->quiet = quiet > SCHEDULER_TIME_MAX ? SCHEDULER_TIME_MAX : quiet;
+    sched->max_delay = max_delay > SCHEDULER_TIME_MAX ? SCHEDULER_TIME_MAX : max_delay;
+    if (sched->max_delay < sched->quiet) {
+        sched->max_delay = sched->quiet;
+    }
+    /* Pending changes are due by new times. */
+    pthread_cond_signal(&sched->cond);
+    pthread_mutex_unlock(&sched->lock);
+}
+
+void
+scheduler_submit(struct scheduler *sched, struct change_set *set)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&sched->lock);
+    if (0 == sched->pending.count) {
+        sched->first = now;
+    }
+    sched->last = now;
+    change_set_merge(&sched->pending, set);
+    sched->submitted++;
+    pthread_cond_signal(&sched->cond);
+    pthread_mutex_unlock(&sched->lock);
+}
+
+bool
+scheduler_pending(struct scheduler *sched)
+{
+    bool pending;
+
+    pthread_mutex_lock(&sched->lock);
+    pending = sched->pending.count > 0;
+    pthread_mutex_unlock(&sched->lock);
+
+    return pending;
+}
+
+void
+scheduler_counters(struct scheduler *sched, unsigned int *quiet, unsigned int *max_delay,
+                   uint64_t *submitted, uint64_t *applied)
+{
+    pthread_mutex_lock(&sched->lock);
+    *quiet = sched->quiet;
+    *max_delay = sched->max_delay;
+    *submitted = sched->submitted;
+    *applied = sched->applied;
+    pthread_mutex_unlock(&sched->lock);
+}
@@ -0,0 +1,70 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "changes.h"
+
+#define SCHEDULER_QUIET_DEFAULT 200     /* ms without changes before apply */
+#define SCHEDULER_DELAY_DEFAULT 1000    /* ms at most since first pending change */
+#define SCHEDULER_TIME_MAX 60000
+
+/**
+ * @brief Apply merged changes, set is freed by scheduler afterwards.
+ */
+typedef void (*scheduler_apply_cb)(struct change_set *set, void *arg);
+
+/**
+ * Debounce of configuration changes.
+ *
+ * Change sets submitted in a burst are merged into one pending set,
+ * which is applied once no change came for quiet window, or once max
+ * delay passed since first pending change, whatever comes first.
+ */
+struct scheduler {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct change_set pending;
+    struct timespec first;          /* first change in pending set */
+    struct timespec last;           /* last change in pending set */
+    unsigned int quiet;             /* quiet window in ms */
+    unsigned int max_delay;         /* max delay in ms */
+    bool stop;
+    uint64_t submitted;             /* change sets submitted */
+    uint64_t applied;               /* merged sets applied */
+    scheduler_apply_cb apply;
+    void *arg;
+};
+
+int scheduler_init(struct scheduler *sched, scheduler_apply_cb apply, void *arg);
+
+/**
+ * @brief Apply pending changes and stop scheduler thread.
+ */
+void scheduler_cleanup(struct scheduler *sched);
+
+/**
+ * @brief Set quiet window and max delay in milliseconds.
+ *
+ * Quiet window of zero applies every change set right away.
+ */
+void scheduler_set_times(struct scheduler *sched, unsigned int quiet, unsigned int max_delay);
+
+/**
+ * @brief Merge change set into pending changes, set is left empty.
+ */
+void scheduler_submit(struct scheduler *sched, struct change_set *set);
+
+/**
+ * @brief Check if changes are waiting for quiet window or max delay.
+ */
+bool scheduler_pending(struct scheduler *sched);
+
+void scheduler_counters(struct scheduler *sched, unsigned int *quiet, unsigned int *max_delay,
+                        uint64_t *submitted, uint64_t *applied);
+
+#endif /* __SCHEDULER_H__ */
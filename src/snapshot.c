@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "common.h"
+
+#define LINK_TABLE_INIT_SIZE 64
+
+/* Cached collection of one container for one or all interfaces. */
+struct snapshot_entry {
+    struct list_head head;
+    snapshot_container container;
+    char ifname[IF_NAMESIZE];       /* empty for all interfaces */
+    struct timespec stamp;
+    bool collecting;
+    int waiters;
+    struct snapshot_data *data;
+};
+
+static int
+link_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct link_state *) a)->name, ((const struct link_state *) b)->name);
+}
+
+struct link_state *
+link_table_add(struct link_table *table)
+{
+    struct link_state *entries;
+    size_t size;
+
+    if (table->count == table->size) {
+        size = table->size ? table->size * 2 : LINK_TABLE_INIT_SIZE;
+        entries = realloc(table->entries, size * sizeof(*entries));
+        if (!entries) {
+            return NULL;
+        }
+        table->entries = entries;
+        table->size = size;
+    }
+
+    return memset(&table->entries[table->count++], 0, sizeof(struct link_state));
+}
+
+void
+link_table_sort(struct link_table *table)
+{
+    qsort(table->entries, table->count, sizeof(struct link_state), link_cmp);
+}
+
+struct link_state *
+link_find(struct link_table *table, const char *name)
+{
+    struct link_state key;
+
+    if (!table->count) {
+        return NULL;
+    }
+
+    snprintf(key.name, sizeof(key.name), "%s", name);
+
+    return bsearch(&key, table->entries, table->count, sizeof(struct link_state), link_cmp);
+}
+
+void
+link_table_free(struct link_table *table)
+{
+    for (size_t i = 0; i < table->count; i++) {
+        free(table->entries[i].addrs4);
+        free(table->entries[i].addrs6);
+    }
+    free(table->entries);
+    table->entries = NULL;
+    table->count = 0;
+    table->size = 0;
+}
+
+static int
+neigh_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct neigh_state *) a)->name, ((const struct neigh_state *) b)->name);
+}
+
+struct neigh_state *
+neigh_table_add(struct neigh_table *table)
+{
+    struct neigh_state *entries;
+    size_t size;
+
+    if (table->count == table->size) {
+        size = table->size ? table->size * 2 : LINK_TABLE_INIT_SIZE;
+        entries = realloc(table->entries, size * sizeof(*entries));
+        if (!entries) {
+            return NULL;
+        }
+        table->entries = entries;
+        table->size = size;
+    }
+
+    return memset(&table->entries[table->count++], 0, sizeof(struct neigh_state));
+}
+
+void
+neigh_table_sort(struct neigh_table *table)
+{
+    qsort(table->entries, table->count, sizeof(struct neigh_state), neigh_cmp);
+}
+
+struct neigh_state *
+neigh_find(struct neigh_table *table, const char *name)
+{
+    struct neigh_state key;
+
+    if (!table->count) {
+        return NULL;
+    }
+
+    snprintf(key.name, sizeof(key.name), "%s", name);
+
+    return bsearch(&key, table->entries, table->count, sizeof(struct neigh_state), neigh_cmp);
+}
+
+void
+neigh_table_free(struct neigh_table *table)
+{
+    for (size_t i = 0; i < table->count; i++) {
+        free(table->entries[i].neighs4);
+        free(table->entries[i].neighs6);
+    }
+    free(table->entries);
+    table->entries = NULL;
+    table->count = 0;
+    table->size = 0;
+}
+
+void
+snapshot_data_free(struct snapshot_data *data)
+{
+    link_table_free(&data->links);
+    neigh_table_free(&data->neighs);
+    stats_table_free(&data->stats);
+    free(data);
+}
+
+/* Drop reference, snap->lock is held. */
+static void
+snapshot_data_unref(struct snapshot_data *data)
+{
+    if (data && 0 == --data->refs) {
+        snapshot_data_free(data);
+    }
+}
+
+static uint64_t
+elapsed_ms(const struct timespec *from, const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000;
+}
+
+static bool
+snapshot_entry_fresh(struct snapshot *snap, struct snapshot_entry *entry, const struct timespec *now)
+{
+    return entry->data && elapsed_ms(&entry->stamp, now) < snap->ttl;
+}
+
+static void
+snapshot_entry_free(struct snapshot_entry *entry)
+{
+    list_del(&entry->head);
+    snapshot_data_unref(entry->data);
+    free(entry);
+}
+
+int
+snapshot_init(struct snapshot *snap, snapshot_collect_cb collect, void *arg)
+{
+    memset(snap, 0, sizeof(*snap));
+
+    if (pthread_mutex_init(&snap->lock, NULL)) {
+        return -1;
+    }
+    if (pthread_cond_init(&snap->done, NULL)) {
+        pthread_mutex_destroy(&snap->lock);
+        return -1;
+    }
+
+    INIT_LIST_HEAD(&snap->entries);
+    snap->ttl = SNAPSHOT_TTL_DEFAULT;
+    snap->collect = collect;
+    snap->arg = arg;
+
+    return 0;
+}
+
+void
+snapshot_cleanup(struct snapshot *snap)
+{
+    struct snapshot_entry *entry, *tmp;
+
+    list_for_each_entry_safe(entry, tmp, &snap->entries, head) {
+        snapshot_entry_free(entry);
+    }
+
+    pthread_cond_destroy(&snap->done);
+    pthread_mutex_destroy(&snap->lock);
+}
+
+void
+snapshot_set_ttl(struct snapshot *snap, unsigned int ttl)
+{
+    pthread_mutex_lock(&snap->lock);
+    snap->ttl = ttl > SNAPSHOT_TTL_MAX ? SNAPSHOT_TTL_MAX : ttl;
+    pthread_mutex_unlock(&snap->lock);
+}
+
+void
+snapshot_counters(struct snapshot *snap, unsigned int *ttl, uint64_t *hits,
+                  uint64_t *misses, uint64_t *coalesced)
+{
+    pthread_mutex_lock(&snap->lock);
+    *ttl = snap->ttl;
+    *hits = snap->hits;
+    *misses = snap->misses;
+    *coalesced = snap->coalesced;
+    pthread_mutex_unlock(&snap->lock);
+}
+
+/* Find entry usable for request and drop stale ones, snap->lock is held. */
+static struct snapshot_entry *
+snapshot_lookup(struct snapshot *snap, snapshot_container container, const char *ifname,
+                const struct timespec *now)
+{
+    struct snapshot_entry *entry, *tmp;
+    struct snapshot_entry *exact = NULL;
+    struct snapshot_entry *all = NULL;
+
+    list_for_each_entry_safe(entry, tmp, &snap->entries, head) {
+        if (!entry->collecting && !entry->waiters && !snapshot_entry_fresh(snap, entry, now)) {
+            snapshot_entry_free(entry);
+            continue;
+        }
+        if (entry->container != container) {
+            continue;
+        }
+        if (!strcmp(entry->ifname, ifname ? ifname : "")) {
+            exact = entry;
+        } else if (ifname && !entry->ifname[0] && !entry->collecting &&
+                   snapshot_entry_fresh(snap, entry, now)) {
+            all = entry;
+        }
+    }
+
+    /* Fresh collection of all interfaces covers single interface too.
+     * Stale one is never recollected for single interface, request then
+     * gets entry of its own. */
+    return exact ? exact : all;
+}
+
+struct snapshot_data *
+snapshot_get(struct snapshot *snap, snapshot_container container, const char *ifname)
+{
+    struct snapshot_entry *entry;
+    struct snapshot_data *data = NULL;
+    struct timespec now;
+    int rc = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&snap->lock);
+
+    entry = snapshot_lookup(snap, container, ifname, &now);
+    if (entry && entry->collecting) {
+        snap->coalesced++;
+        entry->waiters++;
+        while (entry->collecting) {
+            pthread_cond_wait(&snap->done, &snap->lock);
+        }
+        entry->waiters--;
+        goto exit;
+    }
+    if (entry && snapshot_entry_fresh(snap, entry, &now)) {
+        snap->hits++;
+        goto exit;
+    }
+
+    snap->misses++;
+
+    if (!entry) {
+        entry = calloc(1, sizeof(*entry));
+        if (!entry) {
+            pthread_mutex_unlock(&snap->lock);
+            return NULL;
+        }
+        entry->container = container;
+        snprintf(entry->ifname, sizeof(entry->ifname), "%s", ifname ? ifname : "");
+        list_add(&entry->head, &snap->entries);
+    }
+    entry->collecting = true;
+
+    pthread_mutex_unlock(&snap->lock);
+
+    /* Collection runs unlocked, other requests for same key wait on entry.
+     * Entry is collected in its own scope, which never changes. */
+    data = calloc(1, sizeof(*data));
+    if (data) {
+        data->refs = 1;
+        rc = snap->collect(container, entry->ifname[0] ? entry->ifname : NULL, data, snap->arg);
+        if (rc < 0) {
+            snapshot_data_free(data);
+            data = NULL;
+        }
+    }
+
+    pthread_mutex_lock(&snap->lock);
+
+    snapshot_data_unref(entry->data);
+    entry->data = data;
+    clock_gettime(CLOCK_MONOTONIC, &entry->stamp);
+    entry->collecting = false;
+    pthread_cond_broadcast(&snap->done);
+
+  exit:
+    data = entry->data;
+    if (data) {
+        data->refs++;
+    }
+
+    pthread_mutex_unlock(&snap->lock);
+
+    return data;
+}
+
+void
+snapshot_put(struct snapshot *snap, struct snapshot_data *data)
+{
+    if (!data) {
+        return;
+    }
+
+    pthread_mutex_lock(&snap->lock);
+    snapshot_data_unref(data);
+    pthread_mutex_unlock(&snap->lock);
+}
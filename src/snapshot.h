@@ -0,0 +1,162 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include <net/if.h>
+#include <libubox/list.h>
+
+#include "stats.h"
+#include "functions.h"
+
+#define SNAPSHOT_TTL_DEFAULT 50     /* milliseconds */
+#define SNAPSHOT_TTL_MAX 10000
+#define LINK_ADDR_LEN 64
+
+/* Unit of collection cached by snapshot. */
+typedef enum snapshot_container_e {
+    SNAPSHOT_LINK,      /* interface list entry, ipv4 and ipv6 containers */
+    SNAPSHOT_STATS,     /* statistics container */
+    SNAPSHOT_NEIGH,     /* ipv4 and ipv6 neighbor lists */
+} snapshot_container;
+
+/* Link state served from interfaces-state list entry. */
+struct link_state {
+    char name[IF_NAMESIZE];
+    int ifindex;
+    const char *type;           /* static string */
+    const char *oper_status;    /* static string */
+    char phys_address[LINK_ADDR_LEN];
+    bool speed_known;
+    uint64_t speed;
+    unsigned int mtu;
+    bool last_change_known;
+    struct timespec last_change;    /* CLOCK_REALTIME */
+    uint32_t carrier_changes;
+    bool ipv6;                  /* IPv6 available on link */
+    bool ipv6_forwarding;
+    uint32_t ipv6_mtu;
+    struct if_address *addrs4;  /* owned, freed with table */
+    size_t addrs4_cnt;
+    struct if_address *addrs6;
+    size_t addrs6_cnt;
+};
+
+struct link_table {
+    struct link_state *entries;
+    size_t count;
+    size_t size;
+};
+
+/* Neighbor lists of one interface, kept apart from link state since
+ * they may hold thousands of entries. */
+struct neigh_state {
+    char name[IF_NAMESIZE];
+    struct if_neighbor *neighs4;    /* owned, freed with table */
+    size_t neighs4_cnt;
+    struct if_neighbor *neighs6;
+    size_t neighs6_cnt;
+};
+
+struct neigh_table {
+    struct neigh_state *entries;
+    size_t count;
+    size_t size;
+};
+
+/* Result of one collection, not modified once published. */
+struct snapshot_data {
+    int refs;
+    struct link_table links;
+    struct stats_table stats;
+    struct neigh_table neighs;
+};
+
+/**
+ * @brief Collect data for given container.
+ *
+ * @param[in] container Container to collect.
+ * @param[in] ifname Interface name or NULL for all interfaces.
+ * @param[out] data Tables to fill.
+ * @param[in] arg User argument given to snapshot_init.
+ * @return 0 on success, negative error otherwise.
+ */
+typedef int (*snapshot_collect_cb)(snapshot_container container, const char *ifname,
+                                   struct snapshot_data *data, void *arg);
+
+/**
+ * Operational data cache keyed by container and interface.
+ *
+ * Collections younger than ttl are reused. Requests arriving while the
+ * same collection is in progress wait for it instead of starting their own.
+ */
+struct snapshot {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    unsigned int ttl;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t coalesced;
+    struct list_head entries;
+    snapshot_collect_cb collect;
+    void *arg;
+};
+
+int snapshot_init(struct snapshot *snap, snapshot_collect_cb collect, void *arg);
+void snapshot_cleanup(struct snapshot *snap);
+
+/**
+ * @brief Set time to live in milliseconds, 0 disables reuse.
+ */
+void snapshot_set_ttl(struct snapshot *snap, unsigned int ttl);
+
+/**
+ * @brief Get collected data, collecting it if there is no fresh snapshot.
+ *
+ * Data collected for all interfaces also serves requests for one interface.
+ *
+ * @param[in] ifname Interface name or NULL for all interfaces.
+ * @return Referenced data to release with snapshot_put, NULL if collection failed.
+ */
+struct snapshot_data *snapshot_get(struct snapshot *snap, snapshot_container container, const char *ifname);
+
+void snapshot_put(struct snapshot *snap, struct snapshot_data *data);
+
+/**
+ * @brief Free data regardless of references, for data never handed to snapshot.
+ */
+void snapshot_data_free(struct snapshot_data *data);
+
+/**
+ * @brief Read cache counters.
+ */
+void snapshot_counters(struct snapshot *snap, unsigned int *ttl, uint64_t *hits,
+                       uint64_t *misses, uint64_t *coalesced);
+
+/**
+ * @brief Add entry to link table.
+ *
+ * @return Zeroed entry or NULL on allocation failure.
+ */
+struct link_state *link_table_add(struct link_table *table);
+
+/**
+ * @brief Sort link table by name, needed before link_find.
+ */
+void link_table_sort(struct link_table *table);
+
+struct link_state *link_find(struct link_table *table, const char *name);
+
+void link_table_free(struct link_table *table);
+
+/**
+ * @brief Add entry to neighbor table, see link_table_add.
+ */
+struct neigh_state *neigh_table_add(struct neigh_table *table);
+void neigh_table_sort(struct neigh_table *table);
+struct neigh_state *neigh_find(struct neigh_table *table, const char *name);
+void neigh_table_free(struct neigh_table *table);
+
+#endif /* __SNAPSHOT_H__ */
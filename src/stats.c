@@ -0,0 +1,399 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+
+#include <libnl3/netlink/msg.h>
+#include <libnl3/netlink/attr.h>
+
+#include "stats.h"
+#include "common.h"
+
+#define STATS_TABLE_INIT_SIZE 64
+
+#define STATS_LEAF(NAME, TYPE, FIELD) { NAME, TYPE, offsetof(struct if_stats, FIELD) }
+
+/* Leaves are in YANG order. Broadcast and outgoing multicast counters
+ * are not kept by the kernel, so they are not provided. */
+const struct stats_leaf stats_leaves[] = {
+    STATS_LEAF("in-octets",         SR_UINT64_T, in_octets),
+    STATS_LEAF("in-unicast-pkts",   SR_UINT64_T, in_unicast_pkts),
+    STATS_LEAF("in-multicast-pkts", SR_UINT64_T, in_multicast_pkts),
+    STATS_LEAF("in-discards",       SR_UINT32_T, in_discards),
+    STATS_LEAF("in-errors",         SR_UINT32_T, in_errors),
+    STATS_LEAF("in-unknown-protos", SR_UINT32_T, in_unknown_protos),
+    STATS_LEAF("out-octets",        SR_UINT64_T, out_octets),
+    STATS_LEAF("out-unicast-pkts",  SR_UINT64_T, out_unicast_pkts),
+    STATS_LEAF("out-discards",      SR_UINT32_T, out_discards),
+    STATS_LEAF("out-errors",        SR_UINT32_T, out_errors),
+};
+
+const size_t stats_leaves_cnt = sizeof(stats_leaves) / sizeof(stats_leaves[0]);
+
+_Static_assert(sizeof(stats_leaves) / sizeof(stats_leaves[0]) == STATS_COUNTERS,
+               "every counter needs its leaf");
+
+uint64_t
+stats_leaf_value(const struct if_stats *stats, const struct stats_leaf *leaf)
+{
+    return *(const uint64_t *) ((const char *) stats + leaf->offset);
+}
+
+static void
+stats_from_kernel(struct if_stats *stats, const struct rtnl_link_stats64 *k)
+{
+    stats->in_octets = k->rx_bytes;
+    /* Multicast packets are included in rx_packets. */
+    stats->in_unicast_pkts = k->rx_packets > k->multicast ? k->rx_packets - k->multicast : 0;
+    stats->in_multicast_pkts = k->multicast;
+    stats->in_discards = k->rx_dropped;
+    stats->in_errors = k->rx_errors;
+    stats->in_unknown_protos = k->rx_nohandler;
+    stats->out_octets = k->tx_bytes;
+    stats->out_unicast_pkts = k->tx_packets;
+    stats->out_discards = k->tx_dropped;
+    stats->out_errors = k->tx_errors;
+}
+
+static struct if_stats *
+stats_table_add(struct stats_table *table)
+{
+    struct if_stats *entries;
+    size_t size;
+
+    if (table->count == table->size) {
+        size = table->size ? table->size * 2 : STATS_TABLE_INIT_SIZE;
+        entries = realloc(table->entries, size * sizeof(*entries));
+        if (!entries) {
+            return NULL;
+        }
+        table->entries = entries;
+        table->size = size;
+    }
+
+    return memset(&table->entries[table->count++], 0, sizeof(struct if_stats));
+}
+
+static int
+stats_collect_cb(struct nl_msg *msg, void *arg)
+{
+    struct stats_table *table = arg;
+    struct nlmsghdr *nlh = nlmsg_hdr(msg);
+    struct ifinfomsg *ifi = nlmsg_data(nlh);
+    struct nlattr *tb[IFLA_MAX + 1];
+    struct rtnl_link_stats64 k = { 0 };
+    struct if_stats *stats;
+
+    if (nlh->nlmsg_type != RTM_NEWLINK) {
+        return NL_SKIP;
+    }
+
+    if (nlmsg_parse(nlh, sizeof(*ifi), tb, IFLA_MAX, NULL) < 0 || !tb[IFLA_IFNAME]) {
+        return NL_SKIP;
+    }
+
+    if (tb[IFLA_STATS64]) {
+        /* Attribute may be shorter or longer than our structure depending
+         * on kernel version, unknown fields stay zero. */
+        nla_memcpy(&k, tb[IFLA_STATS64], sizeof(k));
+    } else if (tb[IFLA_STATS]) {
+        struct rtnl_link_stats k32 = { 0 };
+
+        nla_memcpy(&k32, tb[IFLA_STATS], sizeof(k32));
+        k.rx_packets = k32.rx_packets;
+        k.tx_packets = k32.tx_packets;
+        k.rx_bytes = k32.rx_bytes;
+        k.tx_bytes = k32.tx_bytes;
+        k.rx_errors = k32.rx_errors;
+        k.tx_errors = k32.tx_errors;
+        k.rx_dropped = k32.rx_dropped;
+        k.tx_dropped = k32.tx_dropped;
+        k.multicast = k32.multicast;
+        k.rx_nohandler = k32.rx_nohandler;
+    } else {
+        return NL_SKIP;
+    }
+
+    stats = stats_table_add(table);
+    if (!stats) {
+        return NL_STOP;
+    }
+
+    stats->ifindex = ifi->ifi_index;
+    stats->wide = NULL != tb[IFLA_STATS64];
+    nla_strlcpy(stats->name, tb[IFLA_IFNAME], sizeof(stats->name));
+    stats_from_kernel(stats, &k);
+
+    return NL_OK;
+}
+
+static int
+stats_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct if_stats *) a)->name, ((const struct if_stats *) b)->name);
+}
+
+/* Send request and parse all link messages of the reply into table. */
+static int
+stats_request(struct nl_sock *sk, struct nl_msg *msg, struct stats_table *table)
+{
+    struct nl_cb *cb;
+    int rc = 0;
+
+    table->count = 0;
+
+    cb = nl_cb_alloc(NL_CB_DEFAULT);
+    if (!cb) {
+        return -NLE_NOMEM;
+    }
+    nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, stats_collect_cb, table);
+
+    rc = nl_send_auto(sk, msg);
+    if (rc < 0) {
+        goto exit;
+    }
+
+    rc = nl_recvmsgs(sk, cb);
+    if (rc < 0) {
+        goto exit;
+    }
+
+    /* Sorted by name for lookups from interface list. */
+    qsort(table->entries, table->count, sizeof(struct if_stats), stats_cmp);
+    rc = 0;
+
+  exit:
+    nl_cb_put(cb);
+    return rc;
+}
+
+int
+stats_collect(struct nl_sock *sk, struct stats_table *table)
+{
+    struct ifinfomsg ifi = { .ifi_family = AF_UNSPEC };
+    struct nl_msg *msg;
+    int rc = 0;
+
+    msg = nlmsg_alloc_simple(RTM_GETLINK, NLM_F_DUMP);
+    if (!msg) {
+        return -NLE_NOMEM;
+    }
+
+    rc = nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO);
+    if (rc < 0) {
+        goto exit;
+    }
+
+    rc = stats_request(sk, msg, table);
+    if (rc < 0) {
+        ERR("statistics dump failed: %s", nl_geterror(rc));
+    }
+
+  exit:
+    nlmsg_free(msg);
+    return rc;
+}
+
+int
+stats_collect_one(struct nl_sock *sk, const char *name, struct stats_table *table)
+{
+    struct ifinfomsg ifi = { .ifi_family = AF_UNSPEC };
+    struct nl_msg *msg;
+    int rc = 0;
+
+    msg = nlmsg_alloc_simple(RTM_GETLINK, 0);
+    if (!msg) {
+        return -NLE_NOMEM;
+    }
+
+    rc = nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO);
+    if (rc < 0) {
+        goto exit;
+    }
+
+    rc = nla_put_string(msg, IFLA_IFNAME, name);
+    if (rc < 0) {
+        goto exit;
+    }
+
+    rc = stats_request(sk, msg, table);
+
+  exit:
+    nlmsg_free(msg);
+    return rc;
+}
+
+struct if_stats *
+stats_find(struct stats_table *table, const char *name)
+{
+    struct if_stats key;
+
+    if (!table->count) {
+        return NULL;
+    }
+
+    snprintf(key.name, sizeof(key.name), "%s", name);
+
+    return bsearch(&key, table->entries, table->count, sizeof(struct if_stats), stats_cmp);
+}
+
+void
+stats_table_free(struct stats_table *table)
+{
+    free(table->entries);
+    table->entries = NULL;
+    table->count = 0;
+    table->size = 0;
+}
+
+static int
+base_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct stats_base *) a)->name, ((const struct stats_base *) b)->name);
+}
+
+static uint64_t *
+stats_counter(struct if_stats *stats, size_t i)
+{
+    return (uint64_t *) ((char *) stats + stats_leaves[i].offset);
+}
+
+static void
+base_take(struct stats_base *base, struct if_stats *stats)
+{
+    for (size_t i = 0; i < STATS_COUNTERS; i++) {
+        base->raw[i] = *stats_counter(stats, i);
+    }
+    base->ifindex = stats->ifindex;
+}
+
+/* Compare new kernel counters with last ones and update offsets. */
+static void
+base_update(struct stats_base *base, struct if_stats *stats, const struct timespec *now)
+{
+    bool reset = base->ifindex != stats->ifindex;
+    uint64_t raw;
+
+    for (size_t i = 0; i < STATS_COUNTERS && !reset; i++) {
+        raw = *stats_counter(stats, i);
+        if (raw < base->raw[i] && (stats->wide || base->raw[i] < (UINT64_C(1) << 31))) {
+            reset = true;
+        }
+    }
+
+    for (size_t i = 0; i < STATS_COUNTERS; i++) {
+        raw = *stats_counter(stats, i);
+        if (reset) {
+            /* Counting went on from zero, what was counted before is kept. */
+            base->offset[i] += base->raw[i];
+        } else if (raw < base->raw[i]) {
+            base->offset[i] += UINT64_C(1) << 32;
+        }
+    }
+
+    if (reset) {
+        base->discontinuity = *now;
+        INF("counters of %s were reset", base->name);
+    }
+
+    base_take(base, stats);
+}
+
+int
+stats_continuity_init(struct stats_continuity *cont)
+{
+    memset(cont, 0, sizeof(*cont));
+
+    return pthread_mutex_init(&cont->lock, NULL) ? -1 : 0;
+}
+
+void
+stats_continuity_cleanup(struct stats_continuity *cont)
+{
+    free(cont->entries);
+    pthread_mutex_destroy(&cont->lock);
+}
+
+/* Turn kernel counters into monotonic ones, cont->lock is held. */
+static void
+continuity_apply(struct stats_continuity *cont, struct stats_table *table, bool full)
+{
+    struct stats_base *base, *entries;
+    struct stats_base key;
+    struct timespec now, mono;
+    size_t sorted, kept = 0;
+    size_t size;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+
+    sorted = cont->count;
+
+    for (size_t i = 0; i < table->count; i++) {
+        struct if_stats *stats = &table->entries[i];
+
+        snprintf(key.name, sizeof(key.name), "%s", stats->name);
+        base = sorted ? bsearch(&key, cont->entries, sorted, sizeof(*base), base_cmp) : NULL;
+        if (base) {
+            base_update(base, stats, &now);
+        } else {
+            /* New interfaces are appended and sorted in below. */
+            if (cont->count == cont->size) {
+                size = cont->size ? cont->size * 2 : STATS_TABLE_INIT_SIZE;
+                entries = realloc(cont->entries, size * sizeof(*entries));
+                if (!entries) {
+                    /* Counters are reported as kernel has them. */
+                    stats->discontinuity = now;
+                    continue;
+                }
+                cont->entries = entries;
+                cont->size = size;
+            }
+            base = memset(&cont->entries[cont->count++], 0, sizeof(*base));
+            snprintf(base->name, sizeof(base->name), "%s", stats->name);
+            base->discontinuity = now;
+            base_take(base, stats);
+        }
+
+        base->seen = mono.tv_sec;
+        for (size_t j = 0; j < STATS_COUNTERS; j++) {
+            *stats_counter(stats, j) += base->offset[j];
+        }
+        stats->discontinuity = base->discontinuity;
+    }
+
+    for (size_t i = 0; i < cont->count; i++) {
+        base = &cont->entries[i];
+        if (full && mono.tv_sec - base->seen > STATS_BASE_EXPIRE) {
+            continue;
+        }
+        if (kept != i) {
+            cont->entries[kept] = *base;
+        }
+        kept++;
+    }
+
+    if (kept != sorted || cont->count != sorted) {
+        cont->count = kept;
+        qsort(cont->entries, cont->count, sizeof(*cont->entries), base_cmp);
+    }
+}
+
+int
+stats_continuity_collect(struct stats_continuity *cont, struct nl_sock *sk, const char *ifname,
+                         struct stats_table *table)
+{
+    int rc;
+
+    /* Dump and apply are one step, a dump taken earlier on another
+     * socket must not be applied after a later one. */
+    pthread_mutex_lock(&cont->lock);
+    rc = ifname ? stats_collect_one(sk, ifname, table) : stats_collect(sk, table);
+    if (rc >= 0) {
+        continuity_apply(cont, table, !ifname);
+    }
+    pthread_mutex_unlock(&cont->lock);
+
+    return rc;
+}
@@ -0,0 +1,146 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include <net/if.h>
+
+#include <libnl3/netlink/netlink.h>
+
+#include "sysrepo.h"
+
+#define STATS_COUNTERS 10               /* counters in struct if_stats */
+#define STATS_BASE_EXPIRE 3600          /* seconds history of vanished interface is kept */
+
+/**
+ * Counters of ietf-interfaces statistics container for one interface.
+ *
+ * All counters are kept 64-bit, counter32 leaves are only narrowed when
+ * values are handed to Sysrepo.
+ */
+struct if_stats {
+    int ifindex;
+    char name[IF_NAMESIZE];
+
+    uint64_t in_octets;
+    uint64_t in_unicast_pkts;
+    uint64_t in_multicast_pkts;
+    uint64_t in_discards;
+    uint64_t in_errors;
+    uint64_t in_unknown_protos;
+    uint64_t out_octets;
+    uint64_t out_unicast_pkts;
+    uint64_t out_discards;
+    uint64_t out_errors;
+
+    bool wide;                      /* kernel reported 64-bit counters */
+    struct timespec discontinuity;  /* CLOCK_REALTIME, set by stats_continuity_collect */
+};
+
+/* Statistics of all interfaces collected by one link dump. */
+struct stats_table {
+    struct if_stats *entries;
+    size_t count;
+    size_t size;
+};
+
+/* Mapping of statistics leaf to its counter. */
+struct stats_leaf {
+    const char *name;
+    sr_type_t type;
+    size_t offset;
+};
+
+extern const struct stats_leaf stats_leaves[];
+extern const size_t stats_leaves_cnt;
+
+/**
+ * @brief Fill table with statistics of all interfaces.
+ *
+ * Single RTM_GETLINK dump is done and IFLA_STATS64 of every link is parsed
+ * (IFLA_STATS is used for kernels without 64-bit statistics).
+ *
+ * @param[in] sk Connected NETLINK_ROUTE socket.
+ * @param[out] table Table to fill, previous content is dropped.
+ * @return 0 on success, negative libnl error otherwise.
+ */
+int stats_collect(struct nl_sock *sk, struct stats_table *table);
+
+/**
+ * @brief Fill table with statistics of single interface.
+ *
+ * Link is requested by name without dumping other interfaces.
+ *
+ * @param[in] sk Connected NETLINK_ROUTE socket.
+ * @param[in] name Interface name.
+ * @param[out] table Table to fill, previous content is dropped.
+ * @return 0 on success, negative libnl error otherwise.
+ */
+int stats_collect_one(struct nl_sock *sk, const char *name, struct stats_table *table);
+
+/**
+ * @brief Find statistics of an interface in collected table.
+ *
+ * @return Statistics entry or NULL if interface was not in the dump.
+ */
+struct if_stats *stats_find(struct stats_table *table, const char *name);
+
+/**
+ * @brief Get value of statistics leaf for given entry.
+ */
+uint64_t stats_leaf_value(const struct if_stats *stats, const struct stats_leaf *leaf);
+
+void stats_table_free(struct stats_table *table);
+
+/* Continuity of counters of one interface, kept by name. */
+struct stats_base {
+    char name[IF_NAMESIZE];
+    int ifindex;
+    uint64_t raw[STATS_COUNTERS];       /* counters last read from kernel */
+    uint64_t offset[STATS_COUNTERS];    /* added to kernel counters */
+    struct timespec discontinuity;      /* CLOCK_REALTIME of last discontinuity */
+    time_t seen;                        /* CLOCK_MONOTONIC seconds of last read */
+};
+
+/**
+ * Counter continuity across interface resets.
+ *
+ * Kernel counters start from zero when a driver is reloaded or when an
+ * interface is deleted and created again under the same name (with a new
+ * ifindex), and 32-bit counters of old kernels wrap. Every collected table
+ * is passed through here: counters lost by a reset are carried in offsets,
+ * so reported counters never go backwards, and the time of the reset is
+ * kept as discontinuity time. Readers of different threads share it, their
+ * dumps are serialized so counters are always applied in kernel order.
+ */
+struct stats_continuity {
+    pthread_mutex_t lock;
+    struct stats_base *entries;         /* sorted by name */
+    size_t count;
+    size_t size;
+};
+
+int stats_continuity_init(struct stats_continuity *cont);
+void stats_continuity_cleanup(struct stats_continuity *cont);
+
+/**
+ * @brief Collect statistics and turn kernel counters into monotonic counters.
+ *
+ * Interfaces seen for the first time take current time as discontinuity
+ * time. A counter going backwards or a changed ifindex is a reset, except
+ * that a 32-bit counter falling back from its upper half is a wrap. When
+ * all interfaces are collected, history of interfaces missing longer than
+ * STATS_BASE_EXPIRE is dropped.
+ *
+ * @param[in] sk Connected NETLINK_ROUTE socket.
+ * @param[in] ifname Interface name or NULL for all interfaces.
+ * @param[out] table Table to fill, previous content is dropped.
+ * @return 0 on success, negative libnl error otherwise.
+ */
+int stats_continuity_collect(struct stats_continuity *cont, struct nl_sock *sk, const char *ifname,
+                             struct stats_table *table);
+
+#endif /* __STATS_H__ */
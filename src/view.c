@@ -0,0 +1,83 @@
+#include <sched.h>
+
+#include "view.h"
+
+void
+view_init(struct view *view, view_free_cb free)
+{
+    atomic_init(&view->current, NULL);
+    atomic_init(&view->epoch, 0);
+    atomic_init(&view->readers[0], 0);
+    atomic_init(&view->readers[1], 0);
+    atomic_init(&view->published, 0);
+    view->retired = NULL;
+    view->retired_epoch = 0;
+    view->free = free;
+}
+
+/* Wait for readers which may still see retired data and free it. */
+static void
+view_reclaim(struct view *view)
+{
+    if (!view->retired) {
+        return;
+    }
+
+    /* Readers arriving late see the new epoch and back off at once. */
+    while (atomic_load(&view->readers[view->retired_epoch & 1])) {
+        sched_yield();
+    }
+
+    view->free(view->retired);
+    view->retired = NULL;
+}
+
+void
+view_cleanup(struct view *view)
+{
+    void *data;
+
+    view_reclaim(view);
+
+    data = atomic_exchange(&view->current, NULL);
+    if (data) {
+        view->free(data);
+    }
+}
+
+void *
+view_read_lock(struct view *view, unsigned int *epoch)
+{
+    unsigned int e;
+
+    for (;;) {
+        e = atomic_load(&view->epoch);
+        atomic_fetch_add(&view->readers[e & 1], 1);
+        /* Counted in epoch that is still current, writer will see us. */
+        if (atomic_load(&view->epoch) == e) {
+            break;
+        }
+        atomic_fetch_sub(&view->readers[e & 1], 1);
+    }
+
+    *epoch = e;
+
+    return atomic_load(&view->current);
+}
+
+void
+view_read_unlock(struct view *view, unsigned int epoch)
+{
+    atomic_fetch_sub(&view->readers[epoch & 1], 1);
+}
+
+void
+view_publish(struct view *view, void *data)
+{
+    /* Epoch parity of data retired last time comes back below. */
+    view_reclaim(view);
+
+    view->retired = atomic_exchange(&view->current, data);
+    view->retired_epoch = atomic_fetch_add(&view->epoch, 1);
+    atomic_fetch_add(&view->published, 1);
+}
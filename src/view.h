@@ -0,0 +1,56 @@
+#ifndef __VIEW_H__
+#define __VIEW_H__
+
+#include <stdatomic.h>
+#include <inttypes.h>
+
+/**
+ * @brief Free published data once no reader can see it.
+ */
+typedef void (*view_free_cb)(void *data);
+
+/**
+ * Immutable data published by a single writer to lock free readers.
+ *
+ * Writer builds new data aside and swaps it in with one atomic store.
+ * Readers announce themselves in the counter of current epoch, writer
+ * advances epoch with every publication, so data replaced in epoch E
+ * is freed once readers of E are gone. That is checked at the next
+ * publication, before epoch parity comes back to E, so readers never
+ * wait and writer waits at most for readers that started before the
+ * previous swap.
+ */
+struct view {
+    _Atomic(void *) current;
+    atomic_uint epoch;
+    atomic_uint readers[2];         /* by epoch parity */
+    void *retired;                  /* writer only, replaced data not yet freed */
+    unsigned int retired_epoch;
+    atomic_uint_fast64_t published;
+    view_free_cb free;
+};
+
+void view_init(struct view *view, view_free_cb free);
+
+/**
+ * @brief Free current and retired data, there must be no readers left.
+ */
+void view_cleanup(struct view *view);
+
+/**
+ * @brief Start reading, never blocks.
+ *
+ * @param[out] epoch To be handed to view_read_unlock.
+ * @return Current data, NULL if nothing was published yet. Valid until
+ * view_read_unlock.
+ */
+void *view_read_lock(struct view *view, unsigned int *epoch);
+
+void view_read_unlock(struct view *view, unsigned int epoch);
+
+/**
+ * @brief Publish new data, may only be called from one thread at a time.
+ */
+void view_publish(struct view *view, void *data);
+
+#endif /* __VIEW_H__ */